@@ -13,6 +13,14 @@ void Architecture::display() const
        << " (total physical qubits: " << mesh_x * mesh_y * qubits_per_core << ")" << endl
        << "ltm_ports: " << ltm_ports << endl;
 
+  cout << "ltm_scheduling: " << ltm_scheduling;
+  if (ltm_scheduling == LTM_SCHED_GREEDY)
+    cout << " (greedy)" << endl;
+  else if (ltm_scheduling == LTM_SCHED_MATCHING)
+    cout << " (matching)" << endl;
+  else
+    cout << " (??\?)" << endl;
+
   cout << "teleportation_type: " << teleportation_type;
   if (teleportation_type == TP_TYPE_A2A)
     cout << " (all to all)" << endl;
@@ -26,6 +34,8 @@ void Architecture::display() const
     cout << " (load independent)" << endl;
   else if (dst_selection_mode == DST_SEL_LOAD_AWARE)
     cout << " (load aware)" << endl;
+  else if (dst_selection_mode == DST_SEL_LOOKAHEAD)
+    cout << " (lookahead)" << endl;
   else
     cout << " (??\?)" << endl;
   
@@ -39,6 +49,8 @@ void Architecture::display() const
     cout << " (random)" << endl;
   else if (mapping_type == MAP_SEQUENTIAL)
     cout << " (sequential)" << endl;
+  else if (mapping_type == MAP_PARTITION)
+    cout << " (partition)" << endl;
   else
     cout << " (??\?)" << endl;
 }
@@ -77,6 +89,8 @@ bool Architecture::readFromFile(const string& file_name)
 	iss >> dst_selection_mode;
       else if (attribute == string("mapping_type"))
 	iss >> mapping_type;
+      else if (attribute == string("ltm_scheduling"))
+	iss >> ltm_scheduling;
       else {
 	cout << "Invalid attribute reading " << file_name
 	     << ": '" << attribute << "'" << endl;
@@ -145,6 +159,11 @@ void Architecture::updateMappingType(const int nv)
   mapping_type = nv;
 }
 
+void Architecture::updateLTMScheduling(const int nv)
+{
+  ltm_scheduling = nv;
+}
+
 void Architecture::updateDerivedVariables()
 {
   number_of_cores = mesh_x * mesh_y;
@@ -10,6 +10,10 @@ using namespace std;
 
 #define DST_SEL_LOAD_INDEPENDENT 0
 #define DST_SEL_LOAD_AWARE       1
+#define DST_SEL_LOOKAHEAD        2
+
+#define LTM_SCHED_GREEDY   0
+#define LTM_SCHED_MATCHING 1
 
 
 struct Architecture
@@ -24,9 +28,10 @@ struct Architecture
   int    teleportation_type;
   int    dst_selection_mode;
   int    mapping_type;
+  int    ltm_scheduling; // policy packing the remote gates in rounds of teleportations
   bool   configured;
   
-  Architecture() : configured(false) {}
+  Architecture() : ltm_scheduling(LTM_SCHED_GREEDY), configured(false) {}
 
   void display() const;
   
@@ -42,6 +47,7 @@ struct Architecture
   void updateTeleportationType(const int nv);
   void updateDstSelectionMode(const int nv);
   void updateMappingType(const int nv);
+  void updateLTMScheduling(const int nv);
 
   void updateDerivedVariables();
 };
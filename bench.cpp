@@ -0,0 +1,362 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <unistd.h>
+#include "architecture.h"
+#include "parameters.h"
+#include "circuit.h"
+#include "communication.h"
+#include "noc.h"
+#include "mapping.h"
+#include "core.h"
+#include "simulation.h"
+#include "statistics.h"
+#include "partition.h"
+
+using namespace std;
+
+// Microbenchmarks of the hot paths of the simulator. Every input is
+// generated from a fixed seed, thus two runs of the suite measure the
+// same work. Each benchmark is repeated until it has run for at least
+// BENCH_MIN_TIME seconds and reports the time and the heap
+// allocations per operation.
+
+#define BENCH_MIN_TIME 0.2
+#define BENCH_SEED     12345
+
+// ----------------------------------------------------------------------
+// Allocation counting: every operator new of the process is counted
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+  allocations++;
+  void* p = malloc(size ? size : 1);
+  if (p == NULL)
+    throw bad_alloc();
+
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+// ----------------------------------------------------------------------
+// Runs op repeatedly and reports ns and allocations per call. setup is
+// run before each call, out of the measure.
+template <typename Setup, typename Op>
+void runBenchmark(const string& name, Setup setup, Op op)
+{
+  long long iterations = 0;
+  double elapsed = 0.0;
+  size_t allocs = 0;
+
+  while (elapsed < BENCH_MIN_TIME)
+    {
+      setup();
+
+      size_t allocs_start = allocations;
+      auto start = chrono::steady_clock::now();
+      op();
+      auto stop = chrono::steady_clock::now();
+      allocs += allocations - allocs_start;
+
+      elapsed += chrono::duration<double>(stop - start).count();
+      iterations++;
+    }
+
+  cout << left << setw(48) << name << right
+       << setw(10) << iterations
+       << setw(16) << fixed << setprecision(0) << elapsed * 1.0e9 / iterations
+       << setw(14) << setprecision(1) << (double)allocs / iterations << endl;
+}
+
+template <typename Op>
+void runBenchmark(const string& name, Op op)
+{
+  runBenchmark(name, [](){}, op);
+}
+
+// ----------------------------------------------------------------------
+// Circuits with the patterns of qcgen
+void qftCircuit(Circuit& circuit, const int nqubits)
+{
+  circuit.clear();
+  for (int qb1=0; qb1<nqubits; qb1++)
+    {
+      circuit.addQubit(qb1);
+      circuit.endGate();
+      circuit.endSlice();
+      for (int qb2=qb1+1; qb2<nqubits; qb2++)
+	{
+	  circuit.addQubit(qb1);
+	  circuit.addQubit(qb2);
+	  circuit.endGate();
+	  circuit.endSlice();
+	}
+    }
+  circuit.number_of_qubits = nqubits;
+}
+
+void cuccaroCircuit(Circuit& circuit, const int n)
+{
+  circuit.clear();
+  for (int i=0; i<n; i++)
+    {
+      circuit.addQubit(i);
+      circuit.addQubit(n+i);
+      circuit.endGate();
+      if ((i+1) < n)
+	{
+	  circuit.addQubit(i+1);
+	  circuit.addQubit(n+i+1);
+	  circuit.endGate();
+	}
+      circuit.endSlice();
+    }
+  circuit.number_of_qubits = 2*n;
+}
+
+// Slice of width disjoint two-qubit gates over nqubits qubits
+ParallelGates randomSlice(const int nqubits, const int width, mt19937& gen)
+{
+  vector<int> qubits(nqubits);
+  for (int qb=0; qb<nqubits; qb++)
+    qubits[qb] = qb;
+  shuffle(qubits.begin(), qubits.end(), gen);
+
+  ParallelGates pgates;
+  for (int g=0; g<width; g++)
+    pgates.push_back({qubits[2*g], qubits[2*g+1]});
+
+  return pgates;
+}
+
+Architecture makeArchitecture(const int mesh_x, const int mesh_y, const int qubits_per_core,
+			      const int ltm_ports)
+{
+  Architecture arch;
+
+  arch.mesh_x = mesh_x;
+  arch.mesh_y = mesh_y;
+  arch.link_width = 8;
+  arch.qubits_per_core = qubits_per_core;
+  arch.ltm_ports = ltm_ports;
+  arch.radio_channels = 4;
+  arch.wireless_enabled = false;
+  arch.teleportation_type = TP_TYPE_A2A;
+  arch.dst_selection_mode = DST_SEL_LOAD_INDEPENDENT;
+  arch.mapping_type = MAP_SEQUENTIAL;
+  arch.updateDerivedVariables();
+  arch.configured = true;
+
+  return arch;
+}
+
+Parameters makeParameters()
+{
+  Parameters params;
+
+  params.gate_delay = 1e-7;
+  params.epr_delay = 1e-6;
+  params.dist_delay = 1e-6;
+  params.pre_delay = 1e-7;
+  params.post_delay = 1e-7;
+  params.noc_clock_time = 1e-9;
+  params.wbit_rate = 1e10;
+  params.token_pass_time = 1e-9;
+  params.memory_bandwidth = 1e11;
+  params.bits_instruction = 8;
+  params.decode_time_per_instruction = 1e-9;
+  params.stats_detailed = false;
+
+  return params;
+}
+
+// ----------------------------------------------------------------------
+void benchCommunicationTimeWired()
+{
+  for (int mesh : {4, 8, 16})
+    for (int ncomms : {16, 128, 1024})
+      {
+	mt19937 gen(BENCH_SEED);
+	int ncores = mesh * mesh;
+	uniform_int_distribution<int> core(0, ncores-1);
+
+	ParallelCommunications pcomms;
+	for (int c=0; c<ncomms; c++)
+	  {
+	    int src = core(gen), dst = core(gen);
+	    if (dst == src)
+	      dst = (src + 1) % ncores;
+	    pcomms.push_back(Communication(src, dst, 16));
+	  }
+
+	NoC noc(mesh, mesh, 8, 1e-9, 16);
+	double t = 0.0;
+	ostringstream name;
+	name << "getCommunicationTimeWired mesh=" << mesh << "x" << mesh << " comms=" << ncomms;
+	runBenchmark(name.str(), [&]() { t += noc.getCommunicationTimeWired(pcomms); });
+      }
+}
+
+void benchRemoteExecution()
+{
+  for (int scheduling : {LTM_SCHED_GREEDY, LTM_SCHED_MATCHING})
+    for (int ltm_ports : {1, 2, 4})
+      for (int width : {8, 32, 128})
+	{
+	  Architecture arch = makeArchitecture(4, 4, 32, ltm_ports);
+	  arch.ltm_scheduling = scheduling;
+	  Parameters params = makeParameters();
+	  NoC noc(arch.mesh_x, arch.mesh_y, arch.link_width, params.noc_clock_time, 16);
+	  int nqubits = arch.number_of_cores * arch.qubits_per_core / 2;
+
+	  mt19937 gen(BENCH_SEED);
+	  ParallelGates rgates = randomSlice(nqubits, width, gen);
+	  Mapping base_mapping(nqubits, arch.number_of_cores, arch.mapping_type, gen);
+
+	  // mapping and cores are updated by the execution, thus they
+	  // are rebuilt before each run
+	  Mapping mapping;
+	  unique_ptr<Cores> cores;
+	  Simulation simulation;
+	  ostringstream name;
+	  name << "remoteExecution " << (scheduling == LTM_SCHED_GREEDY ? "greedy" : "matching")
+	       << " ltm_ports=" << ltm_ports << " width=" << width;
+	  runBenchmark(name.str(),
+		       [&]() { mapping = base_mapping; cores.reset(new Cores(arch, mapping)); },
+		       [&]() { simulation.remoteExecution(arch, noc, params, rgates, mapping, *cores); });
+	}
+}
+
+void benchReadFromFile()
+{
+  char text_fn[] = "/tmp/qcbench_XXXXXX";
+  int fd = mkstemp(text_fn);
+  if (fd < 0)
+    {
+      cerr << "cannot create temporary file" << endl;
+      return;
+    }
+  close(fd);
+  string binary_fn = string(text_fn) + ".bin";
+
+  for (int nqubits : {64, 256, 1024})
+    {
+      Circuit circuit;
+      qftCircuit(circuit, nqubits);
+      circuit.writeTextFile(text_fn);
+      circuit.writeBinaryFile(binary_fn);
+
+      ostringstream name;
+      name << "readFromFile qft" << nqubits << " (" << circuit.number_of_gates << " gates) ";
+      runBenchmark(name.str() + "text", [&]() { circuit.readFromFile(text_fn); });
+      runBenchmark(name.str() + "binary", [&]() { circuit.readFromFile(binary_fn); });
+    }
+
+  remove(text_fn);
+  remove(binary_fn.c_str());
+}
+
+void benchStatistics()
+{
+  for (int n : {64, 512})
+    {
+      Architecture arch = makeArchitecture(4, 4, 2*n, 2);
+      Parameters params = makeParameters();
+      NoC noc(arch.mesh_x, arch.mesh_y, arch.link_width, params.noc_clock_time, 16);
+      Circuit circuit;
+      cuccaroCircuit(circuit, n);
+
+      mt19937 gen(BENCH_SEED);
+      Mapping mapping(circuit.number_of_qubits, arch.number_of_cores, arch.mapping_type, gen);
+      Cores cores(arch, mapping);
+      Simulation simulation;
+      Statistics stats = simulation.simulate(circuit, arch, noc, params, mapping, cores);
+
+      ostringstream suffix;
+      suffix << " cuccaro" << n;
+      double avg, min, max;
+      runBenchmark("getIntercoreCommunications" + suffix.str(),
+		   [&]() { stats.getIntercoreCommunications(cores); });
+      runBenchmark("getOperationsPerQubit" + suffix.str(),
+		   [&]() { stats.getOperationsPerQubit(circuit); });
+      runBenchmark("getTeleportationsAllQubits" + suffix.str(),
+		   [&]() { stats.getTeleportationsAllQubits(circuit.number_of_qubits, cores); });
+      runBenchmark("getCoresStats" + suffix.str(),
+		   [&]() { stats.getCoresStats(cores.history, arch, avg, min, max); });
+    }
+}
+
+void benchPartitionMapping()
+{
+  for (int n : {256, 1024})
+    {
+      Circuit circuit;
+      qftCircuit(circuit, n);
+      InteractionGraphBuilder builder;
+      builder.addGates(circuit.getGates());
+      InteractionGraph graph = builder.build(circuit.number_of_qubits);
+
+      mt19937 gen(BENCH_SEED);
+      ostringstream name;
+      name << "partitionMapping qft" << n << " cores=64";
+      runBenchmark(name.str(), [&]() { Mapping(graph, 64, n, gen); });
+    }
+
+  // sparse circuit of nearby interactions over shuffled qubits
+  for (int n : {10000, 100000})
+    {
+      mt19937 gen(BENCH_SEED);
+      vector<int> label(n);
+      for (int qb=0; qb<n; qb++)
+	label[qb] = qb;
+      shuffle(label.begin(), label.end(), gen);
+
+      InteractionGraphBuilder builder;
+      uniform_int_distribution<int> qubit(0, n-1), offset(1, 40);
+      for (int g=0; g<3*n; g++)
+	{
+	  int qb = qubit(gen);
+	  int qubits[2] = {label[qb], label[(qb + offset(gen)) % n]};
+	  builder.addGate(Gate(qubits, qubits + 2));
+	}
+      InteractionGraph graph = builder.build(n);
+
+      ostringstream name;
+      name << "partitionMapping sparse" << n << " cores=64";
+      runBenchmark(name.str(), [&]() { Mapping(graph, 64, n, gen); });
+    }
+}
+
+int main()
+{
+  cout << left << setw(48) << "benchmark" << right
+       << setw(10) << "runs" << setw(16) << "ns/op" << setw(14) << "allocs/op" << endl;
+
+  benchCommunicationTimeWired();
+  benchRemoteExecution();
+  benchReadFromFile();
+  benchStatistics();
+  benchPartitionMapping();
+
+  return 0;
+}
@@ -2,12 +2,12 @@
 #include <algorithm>
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <set>
 #include <cassert>
 #include <map>
 #include "circuit.h"
 #include "utils.h"
+#include "profiler.h"
 
 using namespace std;
 
@@ -20,65 +20,208 @@ void Circuit::display(const bool verbose)
        << "Number of stages: " << number_of_stages << endl;
 
   // Compute gate distribution
-  map<int,int> inputhist;
-  for (const auto& pg : circuit)
-    for (const auto& g : pg)
-      inputhist[g.size()]++;
+  map<int,int64_t> inputhist;
+  const CsrOffset* goffsets = getGateOffsets();
+  for (int64_t g=0; g<number_of_gates; g++)
+    inputhist[goffsets[g+1] - goffsets[g]]++;
   cout << "Distribution of gates: ";
   for (const auto& hp : inputhist)
     cout << hp.first << "-input: " << hp.second*100.0/number_of_gates << "%, ";
   cout << endl;
   
   if (verbose)
-    for (const auto& parallel_gates : circuit)
-      displayGates(parallel_gates, true);
+    for (int64_t s=0; s<number_of_stages; s++)
+      displayGates(getSlice(s), true);
 }
 
+void Circuit::clear()
+{
+  binary_file.reset();
+  mapped_qubits = NULL;
+  mapped_gate_offsets = mapped_slice_offsets = NULL;
+  qubits.clear();
+  gate_offsets.assign(1, 0);
+  slice_offsets.assign(1, 0);
+  number_of_gates = 0;
+  number_of_stages = 0;
+}
 
-bool Circuit::readFromFile(const string& file_name)
+void Circuit::addQubit(const int qb)
 {
-  circuit.clear();
-  ifstream input_file(file_name);
-  if (!input_file.is_open())
-    return false;
+  qubits.push_back(qb);
+}
 
-  int min_qubit = numeric_limits<int>::max();
-  int max_qubit = numeric_limits<int>::min();
-  string line;
-  while (getline(input_file, line))
+void Circuit::endGate()
+{
+  gate_offsets.push_back(qubits.size());
+  number_of_gates++;
+}
+
+void Circuit::addGate(const Gate& gate)
+{
+  qubits.insert(qubits.end(), gate.begin(), gate.end());
+  endGate();
+}
+
+// Close the current slice, if it contains any gate
+void Circuit::endSlice()
+{
+  if (number_of_gates == slice_offsets.back())
+    return;
+
+  slice_offsets.push_back(number_of_gates);
+  number_of_stages++;
+}
+
+const int* Circuit::getQubits() const
+{
+  return binary_file ? mapped_qubits : qubits.data();
+}
+
+const CsrOffset* Circuit::getGateOffsets() const
+{
+  return binary_file ? mapped_gate_offsets : gate_offsets.data();
+}
+
+const CsrOffset* Circuit::getSliceOffsets() const
+{
+  return binary_file ? mapped_slice_offsets : slice_offsets.data();
+}
+
+GatesView Circuit::getSlice(const int64_t s) const
+{
+  const CsrOffset* soffsets = getSliceOffsets();
+  
+  return GatesView(getQubits(), getGateOffsets() + soffsets[s],
+		   soffsets[s+1] - soffsets[s]);
+}
+
+GatesView Circuit::getGates() const
+{
+  return GatesView(getQubits(), getGateOffsets(), number_of_gates);
+}
+
+
+// Parse the gates of the line starting at p, of the form
+// "(q q) (q) ...", as a new slice. On return p points past the end
+// of the line. Returns false and sets error on malformed input.
+bool Circuit::parseTextLine(const char*& p, const char* end,
+			    int& min_qubit, int& max_qubit, string& error)
+{
+  while (p != end && *p != '\n')
     {
-      istringstream iss(line);
-      ParallelGates parallel_gates;
+      char ch = *p;
+      if (ch == ' ' || ch == '\t' || ch == '\r')
+	{
+	  p++;
+	  continue;
+	}
+
+      if (ch != '(')
+	{
+	  error = string("expected '(' but found '") + ch + "'";
+	  return false;
+	}
+      p++;
 
-      char opening_parenthesis, closing_parenthesis;
-      while (iss >> opening_parenthesis)
+      while (true)
 	{
-	  Gate gate;
-	  int qubit;
+	  while (p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+	    p++;
 
-	  while (iss >> qubit)
+	  if (p == end || *p == '\n')
 	    {
-	      gate.push_back(qubit);
-	      if (qubit < min_qubit) min_qubit = qubit;
-	      if (qubit > max_qubit) max_qubit = qubit;
+	      error = "missing ')'";
+	      return false;
 	    }
+
+	  if (*p == ')')
+	    {
+	      p++;
+	      break;
+	    }
+
+	  bool negative = (*p == '-');
+	  if (negative)
+	    p++;
 	  
-	  parallel_gates.push_back(gate);
-	  number_of_gates++;
-	  
-	  iss.clear();
-	  iss >> closing_parenthesis;
+	  if (p == end || *p < '0' || *p > '9')
+	    {
+	      error = (p == end || *p == '\n') ? string("missing ')'") :
+		string("unexpected character '") + *p + "'";
+	      return false;
+	    }
+
+	  long long qubit = 0;
+	  while (p != end && *p >= '0' && *p <= '9')
+	    {
+	      qubit = qubit * 10 + (*p - '0');
+	      if (qubit > numeric_limits<int>::max())
+		{
+		  error = "qubit id out of range";
+		  return false;
+		}
+	      p++;
+	    }
+	  if (negative)
+	    qubit = -qubit;
+
+	  addQubit(qubit);
+	  if (qubit < min_qubit) min_qubit = qubit;
+	  if (qubit > max_qubit) max_qubit = qubit;
 	}
 
-      if (!parallel_gates.empty())
+      endGate();
+    }
+
+  if (p != end)
+    p++; // skip '\n'
+
+  endSlice();
+  
+  return true;
+}
+
+// The format of the file, binary or text, is detected from its header
+bool Circuit::readFromFile(const string& file_name)
+{
+  PROFILE_SCOPE("read circuit");
+  clear();
+
+  shared_ptr<MappedFile> input_file(new MappedFile);
+  if (!input_file->open(file_name))
+    return false;
+
+  if (input_file->size >= 8 && equal(input_file->data, input_file->data + 8, CIRCUIT_BINARY_MAGIC))
+    return readBinaryFile(input_file, file_name);
+  else
+    return readTextFile(*input_file, file_name);
+}
+
+bool Circuit::readTextFile(const MappedFile& input_file, const string& file_name)
+{
+  int min_qubit = numeric_limits<int>::max();
+  int max_qubit = numeric_limits<int>::min();
+  const char* p = input_file.data;
+  const char* end = p + input_file.size;
+  int64_t line_no = 1;
+  string error;
+
+  // a gate takes at least 4 characters and a qubit id 2, thus these
+  // are conservative estimates saving most of the reallocations
+  qubits.reserve(input_file.size / 6);
+  gate_offsets.reserve(input_file.size / 12);
+  
+  while (p != end)
+    {
+      if (!parseTextLine(p, end, min_qubit, max_qubit, error))
 	{
-	  circuit.push_back(parallel_gates);
-	  number_of_stages++;
+	  cerr << file_name << ":" << line_no << ": " << error << endl;
+	  return false;
 	}
+      line_no++;
     }
 
-  input_file.close();
-
   if (min_qubit != 0)
     {
       cout << "qubits must start from 0" << endl;
@@ -90,19 +233,159 @@ bool Circuit::readFromFile(const string& file_name)
   return true;
 }
 
+// Check the arrays of a binary circuit, whose first and last offsets
+// are already known to be right. Returns false and sets error on the
+// first inconsistency.
+static bool validateBinaryArrays(const CircuitBinaryHeader& header, const CsrOffset* goffsets,
+				 const CsrOffset* soffsets, const int* qbs, string& error)
+{
+  for (int64_t g=0; g<header.number_of_gates; g++)
+    if (goffsets[g+1] < goffsets[g])
+      {
+	error = "gate offsets not monotonic at gate " + to_string(g);
+	return false;
+      }
+  
+  for (int64_t s=0; s<header.number_of_stages; s++)
+    if (soffsets[s+1] < soffsets[s])
+      {
+	error = "slice offsets not monotonic at slice " + to_string(s);
+	return false;
+      }
+
+  for (int64_t i=0; i<header.number_of_qubit_refs; i++)
+    if (qbs[i] < 0 || qbs[i] >= header.number_of_qubits)
+      {
+	error = "qubit id " + to_string(qbs[i]) + " out of range at position " + to_string(i);
+	return false;
+      }
+  
+  return true;
+}
+
+// The arrays of the circuit are used in place from the mapped
+// file, after a single pass checking that the offsets are monotonic
+// and the qubit ids within the number of qubits.
+bool Circuit::readBinaryFile(const shared_ptr<MappedFile>& input_file, const string& file_name)
+{
+  CircuitBinaryHeader header;
+  if (input_file->size < sizeof(header))
+    {
+      cerr << file_name << ": truncated or corrupted binary circuit" << endl;
+      return false;
+    }
+  copy(input_file->data, input_file->data + sizeof(header), reinterpret_cast<char*>(&header));
+
+  if (header.version != CIRCUIT_BINARY_VERSION || header.byte_order != 0x01020304)
+    {
+      cerr << file_name << ": unsupported binary circuit version or byte order" << endl;
+      return false;
+    }
+
+  // the counts are bounded by the file size before computing the
+  // expected size, so that it cannot overflow
+  int64_t max_count = input_file->size / sizeof(int32_t);
+  bool counts_ok = header.number_of_gates >= 0 && header.number_of_gates < max_count &&
+    header.number_of_stages >= 0 && header.number_of_stages < max_count &&
+    header.number_of_qubit_refs >= 0 && header.number_of_qubit_refs < max_count;
+  if (!counts_ok || input_file->size != sizeof(header) +
+      sizeof(CsrOffset) * (header.number_of_gates + 1 + header.number_of_stages + 1) +
+      sizeof(int32_t) * header.number_of_qubit_refs)
+    {
+      cerr << file_name << ": truncated or corrupted binary circuit" << endl;
+      return false;
+    }
+  
+  const CsrOffset* goffsets = reinterpret_cast<const CsrOffset*>(input_file->data + sizeof(header));
+  const CsrOffset* soffsets = goffsets + header.number_of_gates + 1;
+  if (goffsets[0] != 0 || goffsets[header.number_of_gates] != header.number_of_qubit_refs ||
+      soffsets[0] != 0 || soffsets[header.number_of_stages] != header.number_of_gates)
+    {
+      cerr << file_name << ": inconsistent binary circuit offsets" << endl;
+      return false;
+    }
+
+  const int* qbs = reinterpret_cast<const int*>(soffsets + header.number_of_stages + 1);
+  string error;
+  if (!validateBinaryArrays(header, goffsets, soffsets, qbs, error))
+    {
+      cerr << file_name << ": " << error << endl;
+      return false;
+    }
+
+  binary_file = input_file;
+  mapped_gate_offsets = goffsets;
+  mapped_slice_offsets = soffsets;
+  mapped_qubits = qbs;
+  number_of_qubits = header.number_of_qubits;
+  number_of_gates = header.number_of_gates;
+  number_of_stages = header.number_of_stages;
+  
+  return true;
+}
+
+bool Circuit::writeBinaryFile(const string& file_name) const
+{
+  ofstream output_file(file_name, ios::binary);
+  if (!output_file.is_open())
+    return false;
+
+  CircuitBinaryHeader header;
+  copy(CIRCUIT_BINARY_MAGIC, CIRCUIT_BINARY_MAGIC + 8, header.magic);
+  header.version = CIRCUIT_BINARY_VERSION;
+  header.byte_order = 0x01020304;
+  header.number_of_qubits = number_of_qubits;
+  header.reserved = 0;
+  header.number_of_gates = number_of_gates;
+  header.number_of_stages = number_of_stages;
+  header.number_of_qubit_refs = getGateOffsets()[number_of_gates];
+
+  output_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  output_file.write(reinterpret_cast<const char*>(getGateOffsets()),
+		    sizeof(CsrOffset) * (number_of_gates + 1));
+  output_file.write(reinterpret_cast<const char*>(getSliceOffsets()),
+		    sizeof(CsrOffset) * (number_of_stages + 1));
+  output_file.write(reinterpret_cast<const char*>(getQubits()),
+		    sizeof(int32_t) * header.number_of_qubit_refs);
+
+  return output_file.good();
+}
+
+bool Circuit::writeTextFile(const string& file_name) const
+{
+  ofstream output_file(file_name);
+  if (!output_file.is_open())
+    return false;
+
+  for (int64_t s=0; s<number_of_stages; s++)
+    {
+      for (const auto& gate : getSlice(s))
+	{
+	  output_file << "(";
+	  for (const int* qb = gate.begin(); qb != gate.end(); ++qb)
+	    {
+	      output_file << *qb;
+	      if (qb + 1 != gate.end())
+		output_file << " ";
+	    }
+	  output_file << ") ";
+	}
+      output_file << "\n";
+    }
+
+  return output_file.good();
+}
+
 void Circuit::generateCircuit(const int nqubits, const int ngates,
-			      const vector<float>& gateprob)
+			      const vector<float>& gateprob, mt19937& gen)
 {
-  circuit.clear();
-  int gatecount = 0;
-  int nstages = 0;
+  clear();
   set<int> used_qubits;
-  ParallelGates parallel_gates;
 
-  while (gatecount != ngates)
+  while (number_of_gates != ngates)
     {
-      int fanin = getRandomNumber(gateprob) + 1;
-      set<int> qubits = getRandomNoRepetition(nqubits, fanin);
+      int fanin = getRandomNumber(gateprob, gen) + 1;
+      set<int> qubits = getRandomNoRepetition(nqubits, fanin, gen);
 
       set<int> intersection_set;	
       set_intersection(used_qubits.begin(), used_qubits.end(),
@@ -111,27 +394,23 @@ void Circuit::generateCircuit(const int nqubits, const int ngates,
 
       if (intersection_set.empty())
 	{
-	  // add the gate into the parallel_gates set
-	  Gate gate(qubits.begin(), qubits.end());
-	  parallel_gates.push_back(gate);
-	  gatecount++;
+	  // add the gate into the current stage
+	  for (int qb : qubits)
+	    addQubit(qb);
+	  endGate();
 	  used_qubits.insert(qubits.begin(), qubits.end());
 	}
 
-      if (!intersection_set.empty() || gatecount == ngates)
+      if (!intersection_set.empty() || number_of_gates == ngates)
 	{
-	  assert(!parallel_gates.empty());
-	  circuit.push_back(parallel_gates);
+	  assert(number_of_gates > slice_offsets.back());
+	  endSlice();
 
 	  // start a new stage
-	  parallel_gates.clear();
 	  used_qubits.clear();
-	  nstages++;
 	}
     }
 
   // update attributes
   number_of_qubits = nqubits;
-  number_of_gates = ngates;
-  number_of_stages = nstages;
 }
@@ -1,25 +1,78 @@
 #ifndef __CIRCUIT_H__
 #define __CIRCUIT_H__
 
-#include <list>
 #include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <random>
 #include "gate.h"
+#include "mapped_file.h"
 
+// Binary circuit file (little endian): header followed by the int64
+// arrays gate_offsets[number_of_gates+1] and
+// slice_offsets[number_of_stages+1], then the int32 array
+// qubits[number_of_qubit_refs]. Version 1 had 32-bit counts and
+// offsets.
+#define CIRCUIT_BINARY_MAGIC   "QCOMMBIN"
+#define CIRCUIT_BINARY_VERSION 2
+
+struct CircuitBinaryHeader
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t byte_order; // 0x01020304 as written by the producer
+  int32_t  number_of_qubits;
+  uint32_t reserved;   // 0, aligns the 64-bit fields
+  int64_t  number_of_gates;
+  int64_t  number_of_stages;
+  int64_t  number_of_qubit_refs;
+};
+
+// The circuit is stored in CSR form: gate g spans
+// qubits[gate_offsets[g]..gate_offsets[g+1]) and slice s spans gates
+// slice_offsets[s]..slice_offsets[s+1]. The arrays are either owned
+// or mapped straight from a binary circuit file.
 struct Circuit
 {
-  list<ParallelGates> circuit;
+  vector<int> qubits;
+  vector<CsrOffset> gate_offsets;
+  vector<CsrOffset> slice_offsets;
+  shared_ptr<MappedFile> binary_file; // set when the arrays are mapped
+  const int* mapped_qubits;
+  const CsrOffset* mapped_gate_offsets;
+  const CsrOffset* mapped_slice_offsets;
   int number_of_qubits;
-  int number_of_gates;
-  int number_of_stages;
+  int64_t number_of_gates;
+  int64_t number_of_stages;
 
-  Circuit(): number_of_qubits(0), number_of_gates(0), number_of_stages(0) {}
+  Circuit(): gate_offsets(1, 0), slice_offsets(1, 0), mapped_qubits(NULL), mapped_gate_offsets(NULL), mapped_slice_offsets(NULL), number_of_qubits(0), number_of_gates(0), number_of_stages(0) {}
 
   void display(const bool verbose = true);
 
   bool readFromFile(const string& file_name);
+  bool readTextFile(const MappedFile& input_file, const string& file_name);
+  bool readBinaryFile(const shared_ptr<MappedFile>& input_file, const string& file_name);
+  bool writeBinaryFile(const string& file_name) const;
+  bool writeTextFile(const string& file_name) const;
+  bool parseTextLine(const char*& p, const char* end,
+		     int& min_qubit, int& max_qubit, string& error);
 
   void generateCircuit(const int nqubits, const int ngates,
-		       const vector<float>& gateprob);
+		       const vector<float>& gateprob, mt19937& gen);
+
+  void clear();
+  void addQubit(const int qb);
+  void endGate();
+  void addGate(const Gate& gate);
+  void endSlice();
+  
+  const int* getQubits() const;
+  const CsrOffset* getGateOffsets() const;
+  const CsrOffset* getSliceOffsets() const;
+  
+  GatesView getSlice(const int64_t s) const;
+  GatesView getGates() const;
 };
 
 #endif
@@ -0,0 +1,169 @@
+#include <limits>
+#include <iostream>
+#include <cassert>
+#include "circuit_stream.h"
+#include "profiler.h"
+
+using namespace std;
+
+void CircuitStream::display()
+{
+  cout << endl
+       << "*** Circuit (streamed) ***" << endl
+       << "Number of qubits: " << number_of_qubits << endl
+       << "Number of gates: " << number_of_gates << endl
+       << "Number of stages: " << number_of_stages << endl;
+
+  cout << "Distribution of gates: ";
+  for (const auto& hp : gate_inputs)
+    cout << hp.first << "-input: " << hp.second*100.0/number_of_gates << "%, ";
+  cout << endl;
+}
+
+bool CircuitStream::open(const string& fn, InteractionGraphBuilder* _interactions)
+{
+  PROFILE_SCOPE("scan circuit");
+  file_name = fn;
+  interactions = _interactions;
+  input_file.reset(new MappedFile);
+  if (!input_file->open(file_name))
+    return false;
+
+  binary = (input_file->size >= 8 &&
+	    equal(input_file->data, input_file->data + 8, CIRCUIT_BINARY_MAGIC));
+  
+  if (binary)
+    {
+      if (!binary_circuit.readBinaryFile(input_file, file_name))
+	return false;
+      scanBinaryFile();
+    }
+  else if (!scanTextFile())
+    return false;
+
+  interactions = NULL;
+  cursor = input_file->data;
+  next_stage = 0;
+  
+  return true;
+}
+
+void CircuitStream::countGate(const Gate& gate)
+{
+  gate_inputs[gate.size()]++;
+  if (interactions != NULL)
+    interactions->addGate(gate);
+  for (int qb : gate)
+    {
+      if (qb >= (int)operations_per_qubit.size())
+	operations_per_qubit.resize(qb + 1, 0);
+      operations_per_qubit[qb]++;
+    }
+}
+
+// The lines are parsed one at a time into a scratch circuit which is
+// cleared right after, thus memory stays bounded by the longest line
+bool CircuitStream::scanTextFile()
+{
+  int min_qubit = numeric_limits<int>::max();
+  int max_qubit = numeric_limits<int>::min();
+  const char* p = input_file->data;
+  const char* end = p + input_file->size;
+  int64_t line_no = 1;
+  string error;
+  Circuit line;
+
+  while (p != end)
+    {
+      line.clear();
+      if (!line.parseTextLine(p, end, min_qubit, max_qubit, error))
+	{
+	  cerr << file_name << ":" << line_no << ": " << error << endl;
+	  return false;
+	}
+      if (line.number_of_gates > 0 && min_qubit < 0)
+	{
+	  cout << "qubits must start from 0" << endl;
+	  return false;
+	}
+      
+      for (const auto& gate : line.getGates())
+	countGate(gate);
+      number_of_gates += line.number_of_gates;
+      number_of_stages += line.number_of_stages;
+      line_no++;
+    }
+  
+  if (min_qubit != 0)
+    {
+      cout << "qubits must start from 0" << endl;
+      return false;
+    }
+  
+  number_of_qubits = max_qubit - min_qubit + 1;
+  operations_per_qubit.resize(number_of_qubits, 0);
+  input_file->release(input_file->size);
+
+  return true;
+}
+
+void CircuitStream::scanBinaryFile()
+{
+  number_of_qubits = binary_circuit.number_of_qubits;
+  number_of_gates = binary_circuit.number_of_gates;
+  number_of_stages = binary_circuit.number_of_stages;
+
+  operations_per_qubit.assign(number_of_qubits, 0);
+  for (const auto& gate : binary_circuit.getGates())
+    countGate(gate);
+}
+
+// Replace the content of window with the next max_slices slices of
+// the file. Returns false when the file has been entirely read. The
+// pages of the file already consumed are dropped from memory.
+bool CircuitStream::readSlices(Circuit& window, const int max_slices)
+{
+  PROFILE_SCOPE("read circuit window");
+  window.clear();
+  window.number_of_qubits = number_of_qubits;
+
+  if (binary)
+    {
+      for (; next_stage < number_of_stages && window.number_of_stages < max_slices; next_stage++)
+	{
+	  for (const auto& gate : binary_circuit.getSlice(next_stage))
+	    window.addGate(gate);
+	  window.endSlice();
+	}
+
+      // the three arrays are read in order, release what is behind
+      auto release = [&](const void* first, const void* upto) {
+	input_file->release((const char*)first - input_file->data, (const char*)upto - input_file->data);
+      };
+      const CsrOffset* slice_offsets = binary_circuit.getSliceOffsets();
+      const CsrOffset* gate_offsets = binary_circuit.getGateOffsets();
+      const int* qubits = binary_circuit.getQubits();
+      CsrOffset next_gate = slice_offsets[next_stage];
+      release(slice_offsets, slice_offsets + next_stage);
+      release(gate_offsets, gate_offsets + next_gate);
+      release(qubits, qubits + gate_offsets[next_gate]);
+    }
+  else
+    {
+      const char* end = input_file->data + input_file->size;
+      int min_qubit = numeric_limits<int>::max();
+      int max_qubit = numeric_limits<int>::min();
+      string error;
+
+      while (cursor != end && window.number_of_stages < max_slices)
+	{
+	  // the file has been validated by the first pass
+	  bool parsed = window.parseTextLine(cursor, end, min_qubit, max_qubit, error);
+	  assert(parsed);
+	  (void)parsed;
+	}
+      input_file->release(cursor - input_file->data);
+    }
+
+  return window.number_of_stages > 0;
+}
@@ -0,0 +1,46 @@
+#ifndef __CIRCUIT_STREAM_H__
+#define __CIRCUIT_STREAM_H__
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include "circuit.h"
+#include "mapped_file.h"
+#include "partition.h"
+
+// Sequential reader delivering a circuit file a few slices at a
+// time, so that the whole circuit is never held in memory. Opening
+// the stream makes a first pass over the file to validate it and to
+// collect the figures known upfront for a loaded circuit (number of
+// qubits, gates, stages, operations per qubit).
+struct CircuitStream
+{
+  shared_ptr<MappedFile> input_file;
+  string file_name;
+  bool binary;
+  Circuit binary_circuit; // binary files are mapped in place
+  const char* cursor;     // next line to parse of a text file
+  int64_t next_stage;
+  int number_of_qubits;
+  int64_t number_of_gates;
+  int64_t number_of_stages;
+  map<int,int64_t> gate_inputs; // number of inputs -> number of gates
+  vector<int> operations_per_qubit;
+  InteractionGraphBuilder* interactions; // only set while opening
+
+  CircuitStream() : binary(false), cursor(NULL), next_stage(0), number_of_qubits(0), number_of_gates(0), number_of_stages(0), interactions(NULL) {}
+
+  // the gates met by the first pass are added to interactions, if given
+  bool open(const string& file_name, InteractionGraphBuilder* interactions = NULL);
+  bool readSlices(Circuit& window, const int max_slices);
+
+  void display();
+
+private:
+  bool scanTextFile();
+  void scanBinaryFile();
+  void countGate(const Gate& gate);
+};
+
+#endif
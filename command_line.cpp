@@ -1,16 +1,27 @@
 #include <iostream>
+#include <algorithm>
+#include <thread>
 #include "command_line.h"
+#include "report.h"
 
 using namespace std;
 
 bool checkCommandLine(int argc, char* argv[],
 		      string& circuitfn, string& architecturefn, string& parametersfn,
-		      map<string,string>& params_override)
+		      map<string,string>& params_override,
+		      string& sweepfn, int& nthreads, int& repetitions,
+		      int& output_format, bool& quiet, bool& profile)
 {
   if (argc < 7)
     return false;
 
   params_override.clear();
+  sweepfn.clear();
+  repetitions = 1;
+  output_format = OUTPUT_TEXT;
+  quiet = false;
+  profile = false;
+  nthreads = max(1u, thread::hardware_concurrency());
   
   for (int i=1; i<argc; i++)
     {
@@ -26,6 +37,28 @@ bool checkCommandLine(int argc, char* argv[],
 	  params_override[string(argv[i+1])] = string(argv[i+2]);
 	  i += 2;
 	}
+      else if (arg == "-s")
+	sweepfn = string(argv[++i]);
+      else if (arg == "-j")
+	nthreads = stoi(argv[++i]);
+      else if (arg == "-r")
+	repetitions = stoi(argv[++i]);
+      else if (arg == "-q")
+	quiet = true;
+      else if (arg == "-t")
+	profile = true;
+      else if (arg == "-f")
+	{
+	  string format = argv[++i];
+	  if (format == "text")
+	    output_format = OUTPUT_TEXT;
+	  else if (format == "json")
+	    output_format = OUTPUT_JSON;
+	  else if (format == "csv")
+	    output_format = OUTPUT_CSV;
+	  else
+	    return false;
+	}
       else
 	return false;
     }  
@@ -62,6 +95,8 @@ void overrideParameters(const map<string,string>& params_override,
 	arch.updateDstSelectionMode(stod(value));
       else if (param == "mapping_type")
 	arch.updateMappingType(stod(value));
+      else if (param == "ltm_scheduling")
+	arch.updateLTMScheduling(stoi(value));
       else if (param == "gate_delay")
 	params.updateGateDelay(stod(value));
       else if (param == "epr_delay")
@@ -86,7 +121,37 @@ void overrideParameters(const map<string,string>& params_override,
 	params.updateDecodeTime(stod(value));
       else if (param == "stats_detailed")
 	params.updateStatsDetailed(stod(value));
+      else if (param == "history_checkpoint_period")
+	params.updateHistoryCheckpointPeriod(stoi(value));
+      else if (param == "history_checkpoints")
+	params.updateHistoryCheckpoints(stoi(value));
+      else if (param == "stream_window")
+	params.updateStreamWindow(stoi(value));
+      else if (param == "seed")
+	params.updateSeed(stoul(value));
+      else if (param == "lookahead_window")
+	params.updateLookaheadWindow(stoi(value));
+      else if (param == "rebalance_period")
+	params.updateRebalancePeriod(stoi(value));
+      else if (param == "epr_buffer_depth")
+	params.updateEPRBufferDepth(stoi(value));
       else
 	cout << ">>> Unrecognized parameter '" << param << "' is ignored!" << endl;
     }
 }
+
+// ----------------------------------------------------------------------
+// Reject the combinations of architecture and parameters that the
+// simulator does not model
+bool checkParameters(const Architecture& arch, const Parameters& params)
+{
+  // the rebalancing teleports the qubits directly to their new core
+  if (params.rebalance_period > 0 && arch.teleportation_type != TP_TYPE_A2A)
+    {
+      cerr << "rebalance_period requires all-to-all teleportation (teleportation_type "
+	   << TP_TYPE_A2A << ")" << endl;
+      return false;
+    }
+
+  return true;
+}
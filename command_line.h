@@ -7,8 +7,12 @@
 
 bool checkCommandLine(int argc, char* argv[],
 		      string& circuitfn, string& architecturefn, string& parametersfn,
-		      map<string,string>& params_override);
+		      map<string,string>& params_override,
+		      string& sweepfn, int& nthreads, int& repetitions,
+		      int& output_format, bool& quiet, bool& profile);
 
 void overrideParameters(const map<string,string>& params_override,
 			Architecture& arch, Parameters& params);
+
+bool checkParameters(const Architecture& arch, const Parameters& params);
 #endif
@@ -1,22 +1,113 @@
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <cassert>
 #include "communication_time.h"
 
 using namespace std;
 
-void CommunicationTime::display() const
+void CommunicationTime::display(const bool pipelined, ostream& os) const
 {
   double total_time = getTotalTime();
   
-  cout << "Communication time (s): " << total_time << endl
+  os << "Communication time (s): " << total_time << endl
        << "\tEPR pair generation time (s): " << t_epr << " (" << 100*t_epr/total_time << "%)" << endl
        << "\tEPR pair distribution time (s): " << t_dist << " (" << 100*t_dist/total_time << "%)" << endl
        << "\tPre-processing time (s): " << t_pre << " (" << 100*t_pre/total_time << "%)" << endl
        << "\tClassical transfer time (s): " << t_clas << " (" << 100*t_clas/total_time << "%)" << endl
        << "\tPost-processing time (s): " << t_post << " (" << 100*t_post/total_time << "%)" << endl;
+  if (pipelined)
+    os << "\tEPR pipelining overlap, saved (s): " << t_overlap << " (" << 100*t_overlap/total_time << "%)" << endl;
 }
 
 double CommunicationTime::getTotalTime() const
 {
-  return t_epr + t_dist + t_pre + t_clas + t_post;
+  return t_epr + t_dist + t_pre + t_clas + t_post - t_overlap;
+}
+
+void CommunicationTime::addFieldsToReport(Report& report) const
+{
+  report.add("communication_time", getTotalTime());
+  report.add("epr_generation_time", t_epr);
+  report.add("epr_distribution_time", t_dist);
+  report.add("pre_processing_time", t_pre);
+  report.add("classical_transfer_time", t_clas);
+  report.add("post_processing_time", t_post);
+  report.add("epr_overlap_time", t_overlap);
+}
+
+// ----------------------------------------------------------------------
+void EPRPipeline::reset(const int _depth, const int ncores, const int _ports)
+{
+  depth = _depth;
+  ports = _ports;
+  end = 0.0;
+  generated.assign(ncores * ports, 0.0);
+  ends.assign(ncores * ports, deque<double>());
+}
+
+// ----------------------------------------------------------------------
+// Time a place is free in the buffer of the port
+double EPRPipeline::getSlotFree(const int port) const
+{
+  return (ends[port].size() == (size_t)depth + 1) ? ends[port].front() : 0.0;
+}
+
+// ----------------------------------------------------------------------
+// The port of the core not used yet in the round which can get its
+// next pair first
+int EPRPipeline::selectPort(const int core_id, const vector<bool>& used) const
+{
+  int best = -1;
+  double best_ready = 0.0;
+  for (int p=core_id*ports; p<(core_id+1)*ports; p++)
+    {
+      double ready = max(generated[p], getSlotFree(p));
+      if (!used[p] && (best == -1 || ready < best_ready))
+	{
+	  best = p;
+	  best_ready = ready;
+	}
+    }
+
+  assert(best != -1); // a round uses at most ltm_ports of each core
+  return best;
+}
+
+// ----------------------------------------------------------------------
+double EPRPipeline::addRound(const ParallelCommunications& pcomms, const CommunicationTime& ct)
+{
+  if (depth == 0)
+    return 0.0;
+
+  double previous_end = end;
+  double start = end;
+  vector<bool> used(generated.size(), false);
+  vector<int> round_ports;
+  
+  for (const Communication& comm : pcomms)
+    {
+      int src = selectPort(comm.src_core, used);
+      used[src] = true;
+      int dst = selectPort(comm.dst_core, used);
+      used[dst] = true;
+
+      double ready = max(max(generated[src], getSlotFree(src)),
+			 max(generated[dst], getSlotFree(dst))) + ct.t_epr + ct.t_dist;
+      generated[src] = generated[dst] = ready;
+      start = max(start, ready);
+      round_ports.push_back(src);
+      round_ports.push_back(dst);
+    }
+
+  end = start + ct.t_pre + ct.t_clas + ct.t_post;
+  for (int p : round_ports)
+    {
+      ends[p].push_back(end);
+      if (ends[p].size() > (size_t)depth + 1)
+	ends[p].pop_front();
+    }
+  
+  // a serial round would have lasted the sum of its times
+  return ct.t_epr + ct.t_dist + ct.t_pre + ct.t_clas + ct.t_post - (end - previous_end);
 }
@@ -1,6 +1,14 @@
 #ifndef __COMMUNICATION_TIME_H__
 #define __COMMUNICATION_TIME_H__
 
+#include <iostream>
+#include <deque>
+#include <vector>
+#include "report.h"
+#include "communication.h"
+
+using namespace std;
+
 struct CommunicationTime
 {
   double t_epr; // EPR pair generation time
@@ -8,12 +16,48 @@ struct CommunicationTime
   double t_pre; // Pre-processing time
   double t_clas; // Classical transfer time
   double t_post; // Post-processing time
+  double t_overlap; // Time hidden by generating the EPR pairs ahead (see EPRPipeline)
 
-  CommunicationTime() : t_epr(0.0), t_dist(0.0), t_pre(0.0), t_clas(0.0), t_post(0.0) {}
+  CommunicationTime() : t_epr(0.0), t_dist(0.0), t_pre(0.0), t_clas(0.0), t_post(0.0), t_overlap(0.0) {}
 
-  void display() const;
+  // pipelined shows the time hidden by the EPR pipelining, which is
+  // already deducted from the total
+  void display(const bool pipelined = false, ostream& os = cout) const;
+  void addFieldsToReport(Report& report) const;
 
   double getTotalTime() const;
 };
 
+// Timing of the rounds of teleportations when every LTM port of every
+// core generates the EPR pairs of its next teleportations ahead, into
+// a buffer holding up to depth pairs besides the one in use. The pair
+// of a teleportation is generated and distributed by the two ports it
+// joins, once both are done with their previous pair and have a free
+// place, i.e. the teleportation depth+1 before on each port has
+// ended. A round starts when the pairs of all its teleportations are
+// ready and the previous round has ended. Only the ports a round uses
+// are charged, and the ports keep their state across the slices: the
+// time elapsed outside the rounds (local execution, fetch, ...) is
+// added with advance(). With depth 0 the rounds are serial.
+struct EPRPipeline
+{
+  int depth;
+  int ports;   // LTM ports of each core
+  double end;  // time the last round ended
+  vector<double> generated;    // [core*ports+port]: time the last pair of the port was ready
+  vector<deque<double> > ends; // [core*ports+port]: end of the last depth+1 teleportations of the port
+
+  EPRPipeline() : depth(0), ports(0), end(0.0) {}
+
+  void reset(const int _depth, const int ncores, const int _ports);
+  
+  // Append a round, returns the time it overlaps with the previous
+  // rounds
+  double addRound(const ParallelCommunications& pcomms, const CommunicationTime& ct);
+  void advance(const double elapsed) { end += elapsed; }
+
+  int selectPort(const int core_id, const vector<bool>& used) const;
+  double getSlotFree(const int port) const;
+};
+
 #endif
@@ -1,14 +1,35 @@
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <limits>
 #include "core.h"
 
+size_t Core::size() const
+{
+  return qubits.size();
+}
+
+vector<int>::const_iterator Core::begin() const
+{
+  return qubits.begin();
+}
+
+vector<int>::const_iterator Core::end() const
+{
+  return qubits.end();
+}
+
 Cores::Cores(const Architecture& architecture, const Mapping& mapping)
 {
   ancilla_counter = 0;
   
   cores.resize(architecture.number_of_cores);
+  intercore_communications.resize(architecture.number_of_cores * architecture.number_of_cores, 0);
+  for (auto& core : cores)
+    core.qubits.reserve(architecture.qubits_per_core);
   
-  int nqubits = mapping.qubit2core.size();
+  int nqubits = mapping.getNumberOfQubits();
+  qubit_teleportations.resize(nqubits, 0);
   for (int qb=0; qb<nqubits; qb++)
     {
       if (!mapping.isMapped(qb))
@@ -16,9 +37,9 @@ Cores::Cores(const Architecture& architecture, const Mapping& mapping)
 	  cerr << "qubit " << qb << " is not mapped!" << endl;
 	  assert(false);
 	}
-      int core_no = mapping.qubit2core.at(qb);
+      int core_no = mapping.qubit2CoreSafe(qb);
       
-      cores[core_no].insert(qb);
+      insertQubit(core_no, qb);
       
       if ((int)cores[core_no].size() > architecture.qubits_per_core)
 	{
@@ -27,11 +48,80 @@ Cores::Cores(const Architecture& architecture, const Mapping& mapping)
 	  assert(false);
 	}
     }
+
+  history.start(cores, architecture.qubits_per_core);
+}
+
+void Cores::insertQubit(const int core_id, const int qb)
+{
+  assert(!qubit_slot.contains(qb));
+  
+  qubit_slot.set(qb, cores[core_id].qubits.size());
+  cores[core_id].qubits.push_back(qb);
+}
+
+// The last qubit of the slot array takes the place of the removed one
+void Cores::removeQubit(const int core_id, const int qb)
+{
+  assert(contains(core_id, qb));
+
+  vector<int>& qubits = cores[core_id].qubits;
+  int slot = qubit_slot.get(qb);
+  int last = qubits.back();
+
+  qubits[slot] = last;
+  qubit_slot.set(last, slot);
+  qubits.pop_back();
+  qubit_slot.erase(qb);
+}
+
+bool Cores::contains(const int core_id, const int qb) const
+{
+  if (!qubit_slot.contains(qb))
+    return false;
+
+  const vector<int>& qubits = cores[core_id].qubits;
+  size_t slot = qubit_slot.get(qb);
+  
+  return slot < qubits.size() && qubits[slot] == qb;
+}
+
+// Qubit qb is teleported from src_core to dst_core
+void Cores::moveQubit(const int qb, const int src_core, const int dst_core)
+{
+  removeQubit(src_core, qb);
+  insertQubit(dst_core, qb);
+  history.record(qb, src_core, dst_core);
+  intercore_communications[src_core * cores.size() + dst_core]++;
+  if (qb >= 0)
+    qubit_teleportations[qb]++;
+}
+
+int Cores::getIntercoreCommunications(const int src_core, const int dst_core) const
+{
+  return intercore_communications[src_core * cores.size() + dst_core];
+}
+
+int Cores::getTeleportations(const int qb) const
+{
+  assert(qb >= 0 && qb < (int)qubit_teleportations.size());
+  
+  return qubit_teleportations[qb];
 }
 
 void Cores::saveHistory()
 {
-  history.push_back(cores);
+  history.saveStep(cores);
+}
+
+void Cores::setHistoryCheckpointPeriod(const int period)
+{
+  history.checkpoint_period = period;
+}
+
+void Cores::setHistoryCheckpoints(const int max_checkpoints)
+{
+  history.max_checkpoints = max_checkpoints;
 }
 
 void Cores::display()
@@ -42,8 +132,10 @@ void Cores::display()
   for (int core_id=0; core_id<ncores; core_id++)
     {
       cout << "core " << core_id << ": ";
-      
-      for (const auto& qubit : cores[core_id])
+
+      vector<int> qubits = cores[core_id].qubits;
+      sort(qubits.begin(), qubits.end());
+      for (const auto& qubit : qubits)
 	cout << qubit << " ";
       cout << endl;
     }
@@ -59,15 +151,131 @@ bool Cores::allocateAncilla(const int core_id,
 			    const Architecture& architecture,
 			    Mapping& mapping, int& ancilla)
 {
-  Core core = cores[core_id];
-
-  if ( core.size() >= static_cast<size_t>(architecture.qubits_per_core) )
+  if ( cores[core_id].size() >= static_cast<size_t>(architecture.qubits_per_core) )
     return false;
 
   ancilla = generateAncillaId();
-  cores[core_id].insert(ancilla);
-  mapping.qubit2core[ancilla] = core_id;
+  insertQubit(core_id, ancilla);
+  mapping.mapQubit(ancilla, core_id);
+  history.record(ancilla, NO_CORE, core_id);
   
   return true;
 }
 
+void Cores::freeAncilla(const int core_id, const int ancilla, Mapping& mapping)
+{
+  removeQubit(core_id, ancilla);
+  mapping.unmapQubit(ancilla);
+  history.record(ancilla, core_id, NO_CORE);
+}
+
+// ----------------------------------------------------------------------
+CoresHistory::CoresHistory()
+{
+  dropped_events = 0;
+  checkpoint_period = 0;
+  max_checkpoints = 0;
+  steps = 0;
+  qubits_per_core = 0;
+  sum_avg_u = 0.0;
+  min_u = numeric_limits<double>::max();
+  max_u = numeric_limits<double>::min();
+}
+
+void CoresHistory::start(const vector<Core>& cores, const int _qubits_per_core)
+{
+  qubits_per_core = _qubits_per_core;
+  checkpoints.push_back(CoreCheckpoint(0, 0, cores));
+}
+
+void CoresHistory::record(const int qubit, const int src_core, const int dst_core)
+{
+  events.push_back(CoreEvent(steps, qubit, src_core, dst_core));
+}
+
+void CoresHistory::saveStep(const vector<Core>& cores)
+{
+  double _min_u = numeric_limits<double>::max();
+  double _max_u = numeric_limits<double>::min();
+  double sum_u = 0.0;
+  
+  for (const auto& core : cores)
+    {
+      double utilization = (double)core.size() / qubits_per_core;
+      sum_u += utilization;
+      if (utilization < _min_u) _min_u = utilization;
+      if (utilization > _max_u) _max_u = utilization;      
+    }
+
+  sum_avg_u += sum_u / cores.size();
+  if (_min_u < min_u) min_u = _min_u;
+  if (_max_u > max_u) max_u = _max_u;
+
+  if (checkpoint_period > 0 && steps > 0 && steps % checkpoint_period == 0)
+    {
+      checkpoints.push_back(CoreCheckpoint(dropped_events + events.size(), steps, cores));
+      if (max_checkpoints > 0 && checkpoints.size() > (size_t)max_checkpoints)
+	{
+	  checkpoints.pop_front();
+	  size_t ndrop = checkpoints.front().nevents - dropped_events;
+	  events.erase(events.begin(), events.begin() + ndrop);
+	  dropped_events += ndrop;
+	}
+    }
+  
+  steps++;
+}
+
+// Oldest step whose occupancy can be rebuilt
+int CoresHistory::getFirstStep() const
+{
+  return checkpoints.front().step;
+}
+
+// Occupancy of the cores when step was saved, rebuilt from the last
+// checkpoint preceding it. Qubits of each core are sorted.
+vector<Core> CoresHistory::getOccupancy(const int step) const
+{
+  assert(step >= getFirstStep() && step < steps);
+
+  // events recorded before step was saved, as positions in the log
+  size_t nevents = upper_bound(events.begin(), events.end(), step,
+			       [](const int s, const CoreEvent& e) { return s < e.step; }) - events.begin();
+  
+  auto it_cp = upper_bound(checkpoints.begin(), checkpoints.end(), step,
+			   [](const int s, const CoreCheckpoint& cp) { return s < cp.step; });
+  assert(it_cp != checkpoints.begin());
+  --it_cp;
+  size_t first = it_cp->nevents - dropped_events;
+
+  QubitTable qubit2core;
+  int ncores = it_cp->cores.size();
+  for (int core_id=0; core_id<ncores; core_id++)
+    for (int qb : it_cp->cores[core_id])
+      qubit2core.set(qb, core_id);
+
+  for (size_t i=first; i<nevents; i++)
+    {
+      if (events[i].dst_core == NO_CORE)
+	qubit2core.erase(events[i].qubit);
+      else
+	qubit2core.set(events[i].qubit, events[i].dst_core);
+    }
+
+  vector<Core> cores(ncores);
+  for (int core_id=0; core_id<ncores; core_id++)
+    for (int qb : it_cp->cores[core_id])
+      if (qubit2core.contains(qb))
+	cores[qubit2core.get(qb)].qubits.push_back(qb);
+  for (size_t i=first; i<nevents; i++)
+    {
+      int qb = events[i].qubit;
+      if (events[i].src_core == NO_CORE && qubit2core.contains(qb))
+	cores[qubit2core.get(qb)].qubits.push_back(qb);
+    }
+
+  for (auto& core : cores)
+    sort(core.qubits.begin(), core.qubits.end());
+  
+  return cores;
+}
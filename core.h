@@ -1,28 +1,104 @@
 #ifndef __CORE_H__
 #define __CORE_H__
 
-#include <set>
 #include <vector>
-#include <list>
+#include <deque>
 #include "mapping.h"
 #include "architecture.h"
+#include "qubit_table.h"
 
-typedef set<int> Core; // set of qubits mapped in the core
+// Qubits mapped in a core, stored in an unordered slot array. The slot
+// of each qubit is recorded in Cores::qubit_slot so that insertion,
+// removal and membership are O(1).
+struct Core
+{
+  vector<int> qubits;
+
+  size_t size() const;
+  vector<int>::const_iterator begin() const;
+  vector<int>::const_iterator end() const;
+};
+
+#define NO_CORE -1
+
+// Change of the occupancy of the cores recorded before history step
+// 'step' is saved: qubit moved from src_core to dst_core. Ancilla
+// allocations have src_core == NO_CORE, releases dst_core == NO_CORE.
+struct CoreEvent
+{
+  int step;
+  int qubit;
+  int src_core;
+  int dst_core;
+
+  CoreEvent(int _step, int _qubit, int _src, int _dst) : step(_step), qubit(_qubit), src_core(_src), dst_core(_dst) {}
+};
+
+// Occupancy of the cores after the first nevents events, taken when
+// step was about to be saved
+struct CoreCheckpoint
+{
+  size_t nevents;
+  int step;
+  vector<Core> cores;
+
+  CoreCheckpoint(size_t _nevents, int _step, const vector<Core>& _cores) : nevents(_nevents), step(_step), cores(_cores) {}
+};
+
+// History of the cores stored as a log of events plus a checkpoint
+// every checkpoint_period steps (only the initial one if 0). When
+// max_checkpoints > 0, only the last max_checkpoints checkpoints and
+// the events following the oldest of them are kept, thus the
+// occupancy can be rebuilt for the steps from getFirstStep(). The core
+// utilization of every step is summarized while steps are saved.
+struct CoresHistory
+{
+  deque<CoreEvent> events;
+  size_t dropped_events; // events dropped from the front of the log
+  deque<CoreCheckpoint> checkpoints;
+  int checkpoint_period;
+  int max_checkpoints; // 0: the whole history is kept
+  int steps; // number of saved steps
+  int qubits_per_core;
+  double sum_avg_u, min_u, max_u;
+
+  CoresHistory();
+
+  void start(const vector<Core>& cores, const int _qubits_per_core);
+  void record(const int qubit, const int src_core, const int dst_core);
+  void saveStep(const vector<Core>& cores);
+
+  int getFirstStep() const;
+  vector<Core> getOccupancy(const int step) const;
+};
 
 struct Cores
 {
   vector<Core> cores;
-  list<vector<Core> > history;
+  QubitTable qubit_slot; // position of each qubit in the slot array of its core
+  CoresHistory history;
+  vector<int> intercore_communications; // [src*ncores+dst]: qubits teleported from src to dst
+  vector<int> qubit_teleportations;     // [qb]: number of times qubit qb has been teleported
   int ancilla_counter;
   
   Cores(const Architecture& architecture, const Mapping& mapping);
 
+  void insertQubit(const int core_id, const int qb);
+  void removeQubit(const int core_id, const int qb);
+  bool contains(const int core_id, const int qb) const;
+  void moveQubit(const int qb, const int src_core, const int dst_core);
+  int getIntercoreCommunications(const int src_core, const int dst_core) const;
+  int getTeleportations(const int qb) const;
+  
   bool allocateAncilla(const int core_id,
 		       const Architecture& architecture,
 		       Mapping& mapping, int& ancilla);
+  void freeAncilla(const int core_id, const int ancilla, Mapping& mapping);
   int generateAncillaId();
   
   void saveHistory();
+  void setHistoryCheckpointPeriod(const int period);
+  void setHistoryCheckpoints(const int max_checkpoints);
   
   void display();  
 };
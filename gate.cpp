@@ -1,6 +1,46 @@
 #include <iostream>
+#include <iterator>
 #include "gate.h"
 
+//----------------------------------------------------------------------
+ParallelGates::ParallelGates(const GatesView& gates) : offsets(1, 0)
+{
+  append(gates);
+}
+
+//----------------------------------------------------------------------
+void ParallelGates::clear()
+{
+  qubits.clear();
+  offsets.resize(1);
+}
+
+//----------------------------------------------------------------------
+void ParallelGates::push_back(const Gate& gate)
+{
+  qubits.insert(qubits.end(), gate.begin(), gate.end());
+  offsets.push_back(qubits.size());
+}
+
+//----------------------------------------------------------------------
+void ParallelGates::push_back(initializer_list<int> gate)
+{
+  qubits.insert(qubits.end(), gate.begin(), gate.end());
+  offsets.push_back(qubits.size());
+}
+
+//----------------------------------------------------------------------
+void ParallelGates::append(const GatesView& gates)
+{
+  if (gates.empty())
+    return;
+
+  CsrOffset base = qubits.size();
+  qubits.insert(qubits.end(), gates.qubits + gates.offsets[0], gates.qubits + gates.offsets[gates.ngates]);
+  for (size_t i=1; i<=gates.ngates; i++)
+    offsets.push_back(base + gates.offsets[i] - gates.offsets[0]);
+}
+
 //----------------------------------------------------------------------
 void displayGate(const Gate& gate, bool newline)
 {
@@ -18,7 +58,7 @@ void displayGate(const Gate& gate, bool newline)
 }
 		 
 // ----------------------------------------------------------------------
-void displayGates(const ParallelGates& gates, bool newline)
+void displayGates(const GatesView& gates, bool newline)
 {
   for (const auto& gate : gates)
     displayGate(gate, false);
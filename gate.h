@@ -1,19 +1,104 @@
-#include <algorithm>
 #ifndef __GATE_H__
 #define __GATE_H__
 
-#include <list>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
 
 using namespace std;
 
-typedef list<int> Gate;
-typedef list<Gate> ParallelGates;
+// View over the qubits of a gate, stored contiguously
+struct Gate
+{
+  const int* first;
+  const int* last;
+
+  Gate(const int* _first, const int* _last) : first(_first), last(_last) {}
+
+  const int* begin() const { return first; }
+  const int* end() const { return last; }
+  size_t size() const { return last - first; }
+  bool empty() const { return first == last; }
+  int front() const { return *first; }
+  int operator[](const size_t i) const { return first[i]; }
+};
+
 inline bool operator==(const Gate& a, const Gate& b) {
     return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
 }
 
+// Position in the qubit array of a circuit (or in its gate array,
+// for slice offsets), wide enough for streams of more than 2^31
+// qubit references
+typedef int64_t CsrOffset;
+
+// Iterator over gates stored as a qubit array plus gate offsets
+// (CSR): gate i spans qubits[offsets[i]..offsets[i+1])
+struct GateIterator
+{
+  typedef forward_iterator_tag iterator_category;
+  typedef Gate value_type;
+  typedef ptrdiff_t difference_type;
+  typedef const Gate* pointer;
+  typedef Gate reference;
+
+  const int* qubits;
+  const CsrOffset* offset;
+
+  GateIterator(const int* _qubits, const CsrOffset* _offset) : qubits(_qubits), offset(_offset) {}
+
+  Gate operator*() const { return Gate(qubits + offset[0], qubits + offset[1]); }
+  GateIterator& operator++() { ++offset; return *this; }
+  bool operator==(const GateIterator& other) const { return offset == other.offset; }
+  bool operator!=(const GateIterator& other) const { return offset != other.offset; }
+};
+
+// View over a sequence of gates stored in CSR form
+struct GatesView
+{
+  const int* qubits;
+  const CsrOffset* offsets; // ngates+1 entries
+  size_t ngates;
+
+  GatesView(const int* _qubits, const CsrOffset* _offsets, size_t _ngates) : qubits(_qubits), offsets(_offsets), ngates(_ngates) {}
+
+  GateIterator begin() const { return GateIterator(qubits, offsets); }
+  GateIterator end() const { return GateIterator(qubits, offsets + ngates); }
+  size_t size() const { return ngates; }
+  bool empty() const { return ngates == 0; }
+  Gate operator[](const size_t i) const { return Gate(qubits + offsets[i], qubits + offsets[i+1]); }
+  Gate front() const { return (*this)[0]; }
+};
+
+// Set of gates executed in parallel, stored in CSR form
+struct ParallelGates
+{
+  vector<int> qubits;
+  vector<CsrOffset> offsets;
+
+  ParallelGates() : offsets(1, 0) {}
+  ParallelGates(const GatesView& gates);
+
+  operator GatesView() const { return GatesView(qubits.data(), offsets.data(), size()); }
+
+  GateIterator begin() const { return GateIterator(qubits.data(), offsets.data()); }
+  GateIterator end() const { return GateIterator(qubits.data(), offsets.data() + size()); }
+  size_t size() const { return offsets.size() - 1; }
+  bool empty() const { return offsets.size() == 1; }
+  Gate operator[](const size_t i) const { return Gate(qubits.data() + offsets[i], qubits.data() + offsets[i+1]); }
+  Gate front() const { return (*this)[0]; }
+
+  void clear();
+  void push_back(const Gate& gate);
+  void push_back(initializer_list<int> gate);
+  void append(const GatesView& gates);
+};
+
 void displayGate(const Gate& gate, bool newline);
-void displayGates(const ParallelGates& gates, bool newline);
+void displayGates(const GatesView& gates, bool newline);
 
 
 #endif
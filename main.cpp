@@ -2,11 +2,14 @@
 #include <cmath>
 #include <map>
 #include <cassert>
+#include <random>
+#include <chrono>
 #include "utils.h"
 #include "architecture.h"
 #include "gate.h"
 #include "core.h"
 #include "circuit.h"
+#include "circuit_stream.h"
 #include "communication.h"
 #include "mapping.h"
 #include "statistics.h"
@@ -15,6 +18,9 @@
 #include "parameters.h"
 #include "simulation.h"
 #include "command_line.h"
+#include "sweep.h"
+#include "report.h"
+#include "profiler.h"
 
 using namespace std;
 
@@ -22,22 +28,21 @@ using namespace std;
 int main(int argc, char* argv[])
 {
   string circuit_fn, architecture_fn, parameters_fn;
+  string sweep_fn;
+  int nthreads, repetitions, output_format;
+  bool quiet, profile;
   map<string,string> params_override; // parameter name -> value
   
-  if (!checkCommandLine(argc, argv, circuit_fn, architecture_fn, parameters_fn, params_override))
+  if (!checkCommandLine(argc, argv, circuit_fn, architecture_fn, parameters_fn, params_override,
+			sweep_fn, nthreads, repetitions, output_format, quiet, profile))
     {
-      cerr << "Usage " << argv[0] << " -c <circuit> -a <architecture> -p <parameters> [-o <param> <value>]" << endl;
+      cerr << "Usage " << argv[0] << " -c <circuit> -a <architecture> -p <parameters> [-o <param> <value>] [-s <sweep>] [-r <repetitions>] [-j <threads>] [-f text|json|csv] [-q] [-t]" << endl;
       
       return -1;
     }
 
-  
-  Circuit circuit;
-  if (!circuit.readFromFile(circuit_fn))
-    {
-      cerr << "error reading circuit file" << endl;
-      return -2;
-    }
+  // the profile is displayed on cerr at the end of the run
+  Profiler::enabled = profile;
   
   Architecture architecture;
   if (!architecture.readFromFile(architecture_fn))
@@ -54,27 +59,138 @@ int main(int argc, char* argv[])
     }
 
   overrideParameters(params_override, architecture, parameters);
+  if (!checkParameters(architecture, parameters))
+    return -6;
+
+  // all the randomness of a run derives from the seed, which is
+  // displayed so that any run can be reproduced (a seed drawn from
+  // the clock is made odd, 0 standing for no seed)
+  if (parameters.seed == 0)
+    parameters.seed = chrono::high_resolution_clock::now().time_since_epoch().count() | 1;
+
+  // when streaming, the circuit is read a window of slices at a time
+  // during the simulation. A sweep shares the loaded circuit among
+  // its points, thus it is never streamed
+  Circuit circuit;
+  CircuitStream circuit_stream;
+  bool sweeping = !sweep_fn.empty() || repetitions > 1;
+  bool streaming = (parameters.stream_window > 0 && !sweeping);
+  // the partition mapping needs the interaction graph of the whole
+  // circuit, which a stream collects during its first pass
+  bool partition = (architecture.mapping_type == MAP_PARTITION);
+  InteractionGraphBuilder interactions;
+  bool circuit_read = streaming ?
+    circuit_stream.open(circuit_fn, partition ? &interactions : NULL) :
+    circuit.readFromFile(circuit_fn);
+  if (!circuit_read)
+    {
+      cerr << "error reading circuit file" << endl;
+      return -2;
+    }
+  int number_of_qubits = streaming ? circuit_stream.number_of_qubits : circuit.number_of_qubits;
+
+  // with structured output or in quiet mode only the results are
+  // written, and the setup displays are not even computed
+  bool text_output = (output_format == OUTPUT_TEXT);
+  bool display_setup = text_output && !quiet;
+  if (display_setup)
+    {
+      if (streaming)
+	circuit_stream.display();
+      else
+	circuit.display(false);
+      architecture.display();
+      parameters.display();
+    }
+
+  if (sweeping)
+    {
+      Sweep sweep;
+      if (sweep_fn.empty())
+	sweep.points.push_back(map<string,string>());
+      else if (!sweep.readFromFile(sweep_fn))
+	{
+	  cerr << "error reading sweep file" << endl;
+	  return -5;
+	}
 
-  circuit.display(false);
-  architecture.display();
-  parameters.display();
+      sweep.repetitions = repetitions;
+      if (!sweep.run(circuit, architecture, parameters, nthreads))
+	return -6;
+      if (text_output)
+	sweep.display();
+      else
+	{
+	  ReportWriter writer(cout, output_format);
+	  sweep.writeReports(writer);
+	}
 
+      if (profile)
+	Profiler::display();
+
+      return 0;
+    }
+  
   NoC noc(architecture.mesh_x, architecture.mesh_y, architecture.link_width, parameters.noc_clock_time,
 	  ceil(log2(architecture.qubits_per_core * architecture.number_of_cores)));
   if (architecture.wireless_enabled)
     noc.enableWiNoC(parameters.wbit_rate, architecture.radio_channels, parameters.token_pass_time);
       
-  noc.display();
+  if (display_setup)
+    noc.display();
   
-  Mapping mapping(circuit.number_of_qubits, architecture.number_of_cores, architecture.mapping_type);
+  // a single run draws from the stream of the first repetition
+  seed_seq seq{parameters.seed, 0u};
+  mt19937 gen(seq);
+  Mapping mapping;
+  if (partition)
+    {
+      if (!streaming)
+	interactions.addGates(circuit.getGates());
+      InteractionGraph graph = interactions.build(number_of_qubits);
+      interactions = InteractionGraphBuilder(); // frees the pairs before the simulation
+      mapping = Mapping(graph, architecture.number_of_cores, architecture.qubits_per_core, gen);
+    }
+  else
+    mapping = Mapping(number_of_qubits, architecture.number_of_cores, architecture.mapping_type, gen);
 
   Cores cores(architecture, mapping);
-  cores.display();
+  cores.setHistoryCheckpointPeriod(parameters.history_checkpoint_period);
+  cores.setHistoryCheckpoints(parameters.history_checkpoints);
+  if (display_setup)
+    cores.display();
   
   Simulation simulation;
-  Statistics stats = simulation.simulate(circuit, architecture, noc, parameters, mapping, cores);
+  Statistics stats = streaming ?
+    simulation.simulate(circuit_stream, architecture, noc, parameters, mapping, cores) :
+    simulation.simulate(circuit, architecture, noc, parameters, mapping, cores);
   
-  stats.display(circuit, cores, architecture, parameters.stats_detailed);
+  // the operations per qubit are only reported in detailed
+  // statistics, otherwise only their number is used
+  vector<int> operations_per_qubit;
+  if (!parameters.stats_detailed)
+    operations_per_qubit.resize(number_of_qubits);
+  else if (streaming)
+    operations_per_qubit = circuit_stream.operations_per_qubit;
+  else
+    operations_per_qubit = stats.getOperationsPerQubit(circuit);
+  {
+    PROFILE_SCOPE("statistics");
+    
+    if (text_output)
+      stats.display(operations_per_qubit, cores, architecture, parameters);
+    else
+      {
+	Report report;
+	report.add("seed", (long long)parameters.seed);
+	stats.addToReport(report, operations_per_qubit, cores, architecture, parameters.stats_detailed);
+	ReportWriter writer(cout, output_format);
+	writer.write(report);
+      }
+  }
+
+  if (profile)
+    Profiler::display();
   
   
   return 0;
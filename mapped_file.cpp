@@ -0,0 +1,118 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include "mapped_file.h"
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::open(const string& file_name)
+{
+  close();
+  
+  int fd = ::open(file_name.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) < 0)
+    {
+      ::close(fd);
+      return false;
+    }
+
+  // only regular files have a size and can be mapped
+  if (!S_ISREG(st.st_mode))
+    {
+      bool ok = readAll(fd);
+      ::close(fd);
+      return ok;
+    }
+
+  size = st.st_size;
+  if (size > 0)
+    {
+      void* addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED)
+	{
+	  ::close(fd);
+	  size = 0;
+	  return false;
+	}
+      madvise(addr, size, MADV_SEQUENTIAL);
+      data = static_cast<const char*>(addr);
+      mapped = true;
+    }
+  else
+    data = "";
+
+  ::close(fd);
+  
+  return true;
+}
+
+// Read the file until its end into the buffer
+bool MappedFile::readAll(const int fd)
+{
+  const size_t chunk = 1 << 16;
+  size_t length = 0;
+  
+  for (;;)
+    {
+      buffer.resize(length + chunk);
+      ssize_t n = ::read(fd, buffer.data() + length, chunk);
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n < 0)
+	{
+	  vector<char>().swap(buffer);
+	  return false;
+	}
+      if (n == 0)
+	break;
+      length += n;
+    }
+
+  buffer.resize(length);
+  data = length > 0 ? buffer.data() : "";
+  size = length;
+  
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (mapped)
+    munmap(const_cast<char*>(data), size);
+  vector<char>().swap(buffer);
+  
+  data = NULL;
+  size = 0;
+  mapped = false;
+}
+
+// Drop from memory the pages entirely below offset upto. They are
+// read back from the file if accessed again.
+void MappedFile::release(const size_t upto)
+{
+  release(0, upto);
+}
+
+// Drop from memory the pages entirely between offsets from and upto.
+// A file read into the buffer is kept whole.
+void MappedFile::release(const size_t from, const size_t upto)
+{
+  if (!mapped)
+    return;
+
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t first = ((from + page_size - 1) / page_size) * page_size;
+  size_t last = (upto / page_size) * page_size;
+  
+  if (last > first)
+    madvise(const_cast<char*>(data) + first, last - first, MADV_DONTNEED);
+}
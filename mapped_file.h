@@ -0,0 +1,34 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// Read-only memory mapping of a whole file. Files that cannot be
+// mapped (pipes, FIFOs, terminals) are read whole into a buffer.
+struct MappedFile
+{
+  const char* data;
+  size_t size;
+  bool mapped;
+  vector<char> buffer; // contents of a file that is not mapped
+
+  MappedFile() : data(NULL), size(0), mapped(false) {}
+  ~MappedFile();
+
+  bool open(const string& file_name);
+  void close();
+  void release(const size_t upto);
+  void release(const size_t from, const size_t upto);
+
+private:
+  bool readAll(const int fd);
+
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+};
+
+#endif
@@ -1,41 +1,49 @@
 #include <iostream>
 #include <cassert>
 #include <vector>
-#include <cstdlib>
-#include <random>
-#include <chrono>
 #include <algorithm>
+#include <cmath>
 #include "mapping.h"
+#include "profiler.h"
 
 
-Mapping::Mapping(const int nqubits, const int ncores, const int mapping_type)
+Mapping::Mapping(const int nqubits, const int ncores, const int mapping_type, mt19937& gen)
 {
+  PROFILE_SCOPE("mapping");
+  
   if (mapping_type == MAP_SEQUENTIAL)
-    qubit2core = this->sequentialMapping(nqubits, ncores);
+    qubit2core = QubitTable(this->sequentialMapping(nqubits, ncores));
   else if (mapping_type == MAP_RANDOM)
-    qubit2core = this->randomMapping(nqubits, ncores);
+    qubit2core = QubitTable(this->randomMapping(nqubits, ncores, gen));
   else {
     cerr << "Invalid mapping type" << endl;
     assert(false);
   }
 }
 
+Mapping::Mapping(const InteractionGraph& graph, const int ncores, const int qubits_per_core, mt19937& gen)
+{
+  PROFILE_SCOPE("mapping");
+
+  qubit2core = QubitTable(this->partitionMapping(graph, ncores, qubits_per_core, gen));
+}
+
 void Mapping::display()
 {
   cout << endl
        << "*** Mapping ***" << endl;
   
-  int nqb = qubit2core.size();    
+  int nqb = getNumberOfQubits();
   for (int qb=0; qb<nqb; qb++)
     {
       assert(isMapped(qb));
-      cout << "qubit " << qb << " -> core " << qubit2core[qb] << endl;
+      cout << "qubit " << qb << " -> core " << qubit2core.get(qb) << endl;
     }
 }
 
-map<int,int> Mapping::sequentialMapping(const int nqubits, const int ncores)
+vector<int> Mapping::sequentialMapping(const int nqubits, const int ncores)
 {
-  map<int,int> q2c;
+  vector<int> q2c(nqubits);
   
   int core_id = 0;
   for (int qb=0; qb<nqubits; qb++)
@@ -48,35 +56,58 @@ map<int,int> Mapping::sequentialMapping(const int nqubits, const int ncores)
   return q2c;
 }
 
-map<int,int> Mapping::randomMapping(const int nqubits, const int ncores)
+vector<int> Mapping::randomMapping(const int nqubits, const int ncores, mt19937& gen)
 {
-  srand(time(0));
-
-  map<int, int> mapping;
   vector<int>   cores(nqubits);
 
   for (int i = 0; i < nqubits; ++i)
     cores[i] = i % ncores;
-    
 
-  unsigned seed = chrono::high_resolution_clock::now().time_since_epoch().count();
-  mt19937 gen(seed);
+
   shuffle(cores.begin(), cores.end(), gen);
 
-  for (int i = 0; i < nqubits; ++i)
-    mapping[i] = cores[i];
+  return cores;
+}
+
+// The qubits are spread over the cores as evenly as the other
+// mappings, up to a 3% imbalance when the cores have room for it,
+// which leaves the partitioner some freedom to keep the interacting
+// qubits together
+vector<int> Mapping::partitionMapping(const InteractionGraph& graph, const int ncores,
+				      const int qubits_per_core, mt19937& gen)
+{
+  int nqubits = graph.nvertices;
+  int even = (nqubits + ncores - 1) / ncores;
+  int max_part = max(even, min(qubits_per_core, (int)floor(1.03 * nqubits / ncores)));
 
-  return mapping;
+  return partitionGraph(graph, ncores, max_part, gen);
+}
+
+int Mapping::getNumberOfQubits() const
+{
+  return qubit2core.getNumberOfQubits();
+}
+
+void Mapping::mapQubit(const int qb, const int core_id)
+{
+  qubit2core.set(qb, core_id);
+}
+
+void Mapping::unmapQubit(const int qb)
+{
+  assert(isMapped(qb));
+  
+  qubit2core.erase(qb);
 }
 
 bool Mapping::isMapped(const int qb) const
 {
-  return (qubit2core.find(qb) != qubit2core.end());
+  return qubit2core.contains(qb);
 }
 
 int Mapping::qubit2CoreSafe(const int qb) const
 {
-  assert(qubit2core.find(qb) != qubit2core.end());
+  assert(isMapped(qb));
 
-  return qubit2core.at(qb);
+  return qubit2core.get(qb);
 }
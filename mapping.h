@@ -1,26 +1,42 @@
 #ifndef __MAPPING_H__
 #define __MAPPING_H__
 
-#include <map>
+#include <vector>
+#include <random>
+#include "qubit_table.h"
+#include "partition.h"
 
 #define MAP_RANDOM     0
 #define MAP_SEQUENTIAL 1
+#define MAP_PARTITION  2
 
 using namespace std;
 
 struct Mapping
 {
-  map<int,int> qubit2core; // Indicates where a qubit is mapped onto which core
+  QubitTable qubit2core; // Indicates where a qubit is mapped onto which core
 
   Mapping() {}
 
-  Mapping(const int nqubits, const int ncores, const int mapping_type);
+  // gen is only used by the random mapping
+  Mapping(const int nqubits, const int ncores, const int mapping_type, mt19937& gen);
+
+  // Partition mapping of the qubits, graph being the interaction
+  // graph of the circuit
+  Mapping(const InteractionGraph& graph, const int ncores, const int qubits_per_core, mt19937& gen);
 
   void display();
 
-  map<int,int> sequentialMapping(const int nqubits, const int ncores);
-  map<int,int> randomMapping(const int nqubits, const int ncores);
+  vector<int> sequentialMapping(const int nqubits, const int ncores);
+  vector<int> randomMapping(const int nqubits, const int ncores, mt19937& gen);
+  vector<int> partitionMapping(const InteractionGraph& graph, const int ncores,
+			       const int qubits_per_core, mt19937& gen);
 
+  int getNumberOfQubits() const;
+  
+  void mapQubit(const int qb, const int core_id);
+  void unmapQubit(const int qb);
+  
   bool isMapped(const int qb) const;
   int qubit2CoreSafe(const int qb) const;
 };
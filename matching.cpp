@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <cassert>
+#include "matching.h"
+
+using namespace std;
+
+// Edmonds' blossom algorithm, growing the matching match (-1 for the
+// exposed vertices) along augmenting paths. The blossoms are not
+// contracted in the graph: base maps every vertex to the base of the
+// outermost blossom holding it.
+struct Blossom
+{
+  const vector<vector<int> >& adj;
+  int n;
+  vector<int> match, parent, base;
+  vector<bool> used, in_blossom, seen;
+
+  Blossom(const vector<vector<int> >& _adj, const vector<int>& _match)
+    : adj(_adj), n(_adj.size()), match(_match) {}
+
+  int lca(int a, int b);
+  void markPath(int v, const int b, int child);
+  int findPath(const int root);
+  bool augment(const int root);
+};
+
+// Lowest common ancestor of a and b in the alternating tree
+int Blossom::lca(int a, int b)
+{
+  seen.assign(n, false);
+  while (true)
+    {
+      a = base[a];
+      seen[a] = true;
+      if (match[a] == -1)
+	break;
+      a = parent[match[a]];
+    }
+  while (true)
+    {
+      b = base[b];
+      if (seen[b])
+	return b;
+      b = parent[match[b]];
+    }
+}
+
+// Flag the blossoms on the path from v down to the base b
+void Blossom::markPath(int v, const int b, int child)
+{
+  while (base[v] != b)
+    {
+      in_blossom[base[v]] = in_blossom[base[match[v]]] = true;
+      parent[v] = child;
+      child = match[v];
+      v = parent[match[v]];
+    }
+}
+
+// Breadth-first search of an augmenting path from root, returns its
+// exposed end or -1
+int Blossom::findPath(const int root)
+{
+  used.assign(n, false);
+  parent.assign(n, -1);
+  base.resize(n);
+  iota(base.begin(), base.end(), 0);
+
+  queue<int> q;
+  used[root] = true;
+  q.push(root);
+  while (!q.empty())
+    {
+      int v = q.front();
+      q.pop();
+      for (int to : adj[v])
+	{
+	  if (base[v] == base[to] || match[v] == to)
+	    continue;
+	  if (to == root || (match[to] != -1 && parent[match[to]] != -1))
+	    {
+	      // odd cycle: the vertices of the blossom become even
+	      int b = lca(v, to);
+	      in_blossom.assign(n, false);
+	      markPath(v, b, to);
+	      markPath(to, b, v);
+	      for (int i=0; i<n; i++)
+		if (in_blossom[base[i]])
+		  {
+		    base[i] = b;
+		    if (!used[i])
+		      {
+			used[i] = true;
+			q.push(i);
+		      }
+		  }
+	    }
+	  else if (parent[to] == -1)
+	    {
+	      parent[to] = v;
+	      if (match[to] == -1)
+		return to;
+	      used[match[to]] = true;
+	      q.push(match[to]);
+	    }
+	}
+    }
+
+  return -1;
+}
+
+bool Blossom::augment(const int root)
+{
+  int v = findPath(root);
+  if (v == -1)
+    return false;
+
+  while (v != -1)
+    {
+      int pv = parent[v], ppv = match[pv];
+      match[v] = pv;
+      match[pv] = v;
+      v = ppv;
+    }
+
+  return true;
+}
+
+// ----------------------------------------------------------------------
+void maximumBMatching(const vector<int>& capacity, const vector<pair<int,int> >& edges,
+		      vector<bool>& selected)
+{
+  assert(selected.size() == edges.size());
+
+  // copies of vertex v: first_copy[v]..first_copy[v+1]), then e_u and
+  // e_v of edge i: ncopies + 2*i and ncopies + 2*i + 1
+  vector<int> first_copy(capacity.size() + 1, 0);
+  for (size_t v=0; v<capacity.size(); v++)
+    first_copy[v+1] = first_copy[v] + capacity[v];
+  int ncopies = first_copy[capacity.size()];
+  int n = ncopies + 2 * edges.size();
+
+  vector<vector<int> > adj(n);
+  vector<int> match(n, -1), next_copy(first_copy.begin(), first_copy.end() - 1);
+  for (size_t i=0; i<edges.size(); i++)
+    {
+      int ends[2] = { edges[i].first, edges[i].second };
+      for (int k=0; k<2; k++)
+	{
+	  int e = ncopies + 2 * i + k;
+	  for (int c=first_copy[ends[k]]; c<first_copy[ends[k]+1]; c++)
+	    {
+	      adj[e].push_back(c);
+	      adj[c].push_back(e);
+	    }
+	}
+      adj[ncopies + 2 * i].push_back(ncopies + 2 * i + 1);
+      adj[ncopies + 2 * i + 1].push_back(ncopies + 2 * i);
+
+      // the initial matching: the edges selected take a free copy of
+      // both ends, the others keep e_u and e_v together
+      if (selected[i])
+	for (int k=0; k<2; k++)
+	  {
+	    int c = next_copy[ends[k]]++;
+	    assert(c < first_copy[ends[k]+1]); // selected must be a b-matching
+	    match[c] = ncopies + 2 * i + k;
+	    match[ncopies + 2 * i + k] = c;
+	  }
+      else
+	{
+	  match[ncopies + 2 * i] = ncopies + 2 * i + 1;
+	  match[ncopies + 2 * i + 1] = ncopies + 2 * i;
+	}
+    }
+
+  // only the copies can be exposed, and a vertex without an augmenting
+  // path stays so, thus every copy is tried once
+  Blossom blossom(adj, match);
+  for (int c=0; c<ncopies; c++)
+    if (blossom.match[c] == -1 && !adj[c].empty())
+      blossom.augment(c);
+
+  // the e vertices, matched initially, stay so: e_u and e_v are
+  // matched either together or both to copies
+  for (size_t i=0; i<edges.size(); i++)
+    selected[i] = (blossom.match[ncopies + 2 * i] != (int)(ncopies + 2 * i + 1));
+}
@@ -0,0 +1,21 @@
+#ifndef __MATCHING_H__
+#define __MATCHING_H__
+
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+// Maximum b-matching of a general graph: a set of edges as large as
+// possible where every vertex v ends at most capacity[v] of them.
+// Solved exactly as a maximum matching (Edmonds' blossom algorithm)
+// of the graph where every vertex v is split into capacity[v] copies
+// and every edge (u,v) into the path u - e_u - e_v - v, the copies of
+// u joined to e_u and the copies of v to e_v: edge (u,v) is in the
+// b-matching when e_u and e_v are matched to copies of u and v.
+// selected holds a b-matching on input (e.g. a greedy one, which
+// saves most of the augmentations) and the maximum one on output.
+void maximumBMatching(const vector<int>& capacity, const vector<pair<int,int> >& edges,
+		      vector<bool>& selected);
+
+#endif
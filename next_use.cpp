@@ -0,0 +1,52 @@
+#include "next_use.h"
+
+// Two passes over the gates: the first counts the uses of every
+// qubit, the second fills them in slice order
+void NextUseTable::build(const Circuit& circuit, const int _window)
+{
+  window = _window;
+  offsets.assign(circuit.number_of_qubits + 1, 0);
+  cursor.assign(circuit.number_of_qubits, 0);
+  
+  for (const auto& gate : circuit.getGates())
+    for (int qb : gate)
+      for (int partner : gate)
+	if (partner != qb)
+	  offsets[qb + 1]++;
+  for (int qb=0; qb<circuit.number_of_qubits; qb++)
+    offsets[qb + 1] += offsets[qb];
+
+  uses.resize(offsets[circuit.number_of_qubits]);
+  vector<CsrOffset> pos(offsets.begin(), offsets.end() - 1);
+  for (int64_t s=0; s<circuit.number_of_stages; s++)
+    for (const auto& gate : circuit.getSlice(s))
+      for (int qb : gate)
+	for (int partner : gate)
+	  if (partner != qb)
+	    {
+	      uses[pos[qb]].slice = s;
+	      uses[pos[qb]++].partner = partner;
+	    }
+
+  for (int qb=0; qb<circuit.number_of_qubits; qb++)
+    cursor[qb] = offsets[qb];
+}
+
+const QubitUse* NextUseTable::upcoming(const int qb, const int64_t slice)
+{
+  if (qb < 0 || qb >= (int)cursor.size())
+    return NULL;
+
+  while (cursor[qb] < offsets[qb+1] && uses[cursor[qb]].slice <= slice)
+    cursor[qb]++;
+
+  return uses.data() + cursor[qb];
+}
+
+const QubitUse* NextUseTable::end(const int qb) const
+{
+  if (qb < 0 || qb >= (int)cursor.size())
+    return NULL;
+
+  return uses.data() + offsets[qb+1];
+}
@@ -0,0 +1,40 @@
+#ifndef __NEXT_USE_H__
+#define __NEXT_USE_H__
+
+#include <vector>
+#include "circuit.h"
+
+using namespace std;
+
+// A gate of the given slice acting on a qubit together with partner
+struct QubitUse
+{
+  int64_t slice;
+  int partner;
+};
+
+// Upcoming uses of the qubits over a block of slices (the whole
+// circuit, or the current window when streaming), numbered from 0 at
+// the start of the block. The uses of qubit qb are
+// uses[offsets[qb]..offsets[qb+1]) in slice order, one for each
+// partner of the qubit in each multi-qubit gate. The slices must be
+// visited in increasing order, since cursor skips the uses already
+// past.
+struct NextUseTable
+{
+  int window; // number of slices looked ahead
+  vector<CsrOffset> offsets;
+  vector<QubitUse> uses;
+  vector<CsrOffset> cursor;
+
+  NextUseTable() : window(0), offsets(1, 0) {}
+
+  void build(const Circuit& circuit, const int window);
+  
+  // uses of qb in the slices after slice, the caller stops at the
+  // first one beyond the window
+  const QubitUse* upcoming(const int qb, const int64_t slice);
+  const QubitUse* end(const int qb) const;
+};
+
+#endif
@@ -1,8 +1,12 @@
 #include <limits>
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
 #include <cassert>
+#include <queue>
+#include <algorithm>
 #include "noc.h"
+#include "profiler.h"
 
 NoC::NoC(int _mesh_x, int _mesh_y, int _link_width, double _clock_time, int _qubit_addr_bits)
 {
@@ -13,6 +17,8 @@ NoC::NoC(int _mesh_x, int _mesh_y, int _link_width, double _clock_time, int _qub
   link_width = _link_width;
   clock_time = _clock_time;
   qubit_addr_bits = _qubit_addr_bits;
+
+  buildRouteTable();
   
   // int address_size = ceil(log2(mesh_x * mesh_y * _qubits_per_core));
 
@@ -53,171 +59,110 @@ void NoC::display()
 }
 
 
-map<int,Communication>  NoC::assignCommunicationIds(const ParallelCommunications& pcomms) const
-{
-  map<int,Communication> pcomms_id;
-  int id = 0;
-
-  for (Communication comm : pcomms)
-    pcomms_id.insert({id++, comm});
-  
-  return pcomms_id;
-}
-
-bool NoC::commIsInQueue(const int id, const queue<pair<int,int> >& qc) const
-{
-  queue<pair<int,int> > temp = qc;
-
-  while (!temp.empty())
-    {
-      if (temp.front().first == id)
-	return true;
-
-      temp.pop();
-    }
-  
-  return false;
-}
-
-int NoC::computeStartTime(const queue<pair<int,int>, deque<pair<int,int>>>& qc) const
+// Links are stored in flat arrays indexed by (core, direction), see
+// LINKS_PER_CORE
+int NoC::linkIndex(const int core_id, const int next_core) const
 {
-  /*
-  int st = 0;
-  queue<pair<int,int> > temp = qc;
-
-  while (!temp.empty())
+  int direction;
+
+  if (next_core == core_id)
+    direction = 4;
+  else if (next_core == core_id + 1)
+    direction = 0;
+  else if (next_core == core_id - 1)
+    direction = 1;
+  else if (next_core == core_id + mesh_x)
+    direction = 2;
+  else
     {
-      // st += temp.front().second;
-      st = temp.front().second; 
-      temp.pop();
+      assert(next_core == core_id - mesh_x);
+      direction = 3;
     }
 
-  return st;
-  */
-  
-  return qc.back().second;
+  return core_id * LINKS_PER_CORE + direction;
 }
 
-int NoC::nextClockCycle(const map<pair<int,int>, queue<pair<int,int> > >& links_occupation) const
+// Discrete-event simulation of the wired NoC. Every link holds a FIFO
+// of the communications waiting to traverse it; a communication
+// occupies the link for linkTraversalCycles(volume) cycles once the
+// communications ahead of it have left. The only events are link
+// releases, kept in a priority queue ordered by release cycle. A
+// communication leaving a link requests its next link at the
+// following event, and the requests issued at the same event are
+// served in communication order.
+double NoC::getCommunicationTimeWired(const ParallelCommunications& pcomms) const
 {
-  // the next clock cycle corresponds to the minimum waiting time in the links_occupation structure
-
-  int min_cc = std::numeric_limits<int>::max();
-  for (const auto& l : links_occupation)
+  PROFILE_SCOPE("getCommunicationTimeWired");
+  PROFILE_COUNT("wired communications", pcomms.size());
+  
+  int ncomms = pcomms.size();
+  vector<int> curr_core(ncomms), next_core(ncomms), dst_core(ncomms);
+  vector<int> cycles(ncomms), release(ncomms), next_in_link(ncomms);
+  vector<int> pending(ncomms); // communications waiting to enter their next link
+  
+  int cid = 0;
+  for (const auto& comm : pcomms)
     {
-      queue<pair<int,int> > q = l.second;
-      while (!q.empty())
-	{
-	  int cc = q.front().second;
-	  q.pop();
-	  
-	  if (cc < min_cc)
-	    min_cc = cc;
-	}
+      curr_core[cid] = comm.src_core;
+      dst_core[cid] = comm.dst_core;
+      cycles[cid] = linkTraversalCycles(comm.volume);
+      pending[cid] = cid;
+      cid++;
     }
 
-  return min_cc;
-}
-
-bool NoC::updateLinksOccupation(map<pair<int,int>, queue<pair<int,int>, deque<pair<int,int>>>>& links_occupation,
-				const int cid, Communication& comm,
-				const int clock_cycle) const
-{
-  bool drained = false;
-  
-  int next_core = routingXY(comm.src_core, comm.dst_core);
-
-  pair<int,int> link(comm.src_core, next_core);
-
-  auto it_links_occupation = links_occupation.find(link);
+  int nlinks = mesh_x * mesh_y * LINKS_PER_CORE;
+  vector<int> link_head(nlinks, -1), link_tail(nlinks, -1); // FIFO of communication ids per link
+  priority_queue<pair<int,int>, vector<pair<int,int> >, greater<pair<int,int> > > releases; // (release cycle, link) of the front of each busy link
 
-  if (it_links_occupation == links_occupation.end())
-    {
-      // comm_id is the first one traversing the link
-      queue<pair<int,int> > q;
-      q.push(pair<int,int>(cid, clock_cycle + linkTraversalCycles(comm.volume)));
-      links_occupation[link] = q;
-    }
-  else
+  int clock_cycle = 0;
+  int active = ncomms;
+  while (active > 0)
     {
-      // link is already used
-      if (!commIsInQueue(cid, it_links_occupation->second))
+      for (int c : pending)
 	{
-	  // if the link exists then the queue must contains communications otherwise
-	  // the link is removed from the links_occupation structure
-	  assert(!it_links_occupation->second.empty());
-
-	  // if comm is not yet in queue for the link, add it in queue. It will start when all the
-	  // previous communications left the link
-	  it_links_occupation->second.push(pair<int,int>(cid,
-							 computeStartTime(it_links_occupation->second) +
-							 linkTraversalCycles(comm.volume)));	  
-	}
-      else
-	{
-	  // communication is in queue. If it is in the front and its
-	  // release time passed than it can advance and removed from
-	  // the queue
-	  if (it_links_occupation->second.front().first == cid &&
-	      clock_cycle >= it_links_occupation->second.front().second)
-	    {
-	      comm.src_core = next_core;
-
-	      // check if drained
-	      if (comm.src_core == comm.dst_core)
-		drained = true;
-
-	      // remove the communication from the queue of the current link
-	      it_links_occupation->second.pop();
+	  next_core[c] = routingXY(curr_core[c], dst_core[c]);
+	  int link = linkIndex(curr_core[c], next_core[c]);
 
-	      // check if the queue is empty and in this case remove the link from links_occupation
-	      if (it_links_occupation->second.empty())
-		links_occupation.erase(it_links_occupation);
+	  next_in_link[c] = -1;
+	  if (link_head[link] == -1)
+	    {
+	      // c is the first one traversing the link
+	      release[c] = clock_cycle + cycles[c];
+	      link_head[link] = c;
+	      releases.push(make_pair(release[c], link));
+	    }
+	  else
+	    {
+	      // c starts when all the previous communications left the link
+	      release[c] = release[link_tail[link]] + cycles[c];
+	      next_in_link[link_tail[link]] = c;
 	    }
+	  link_tail[link] = c;
 	}
-    }
-
-  return drained;
-}
+      pending.clear();
 
-double NoC::getCommunicationTimeWired(const ParallelCommunications& pcomms) const
-{
-  map<pair<int,int>, queue<pair<int,int>, deque<pair<int,int>>>> links_occupation; // links_occupation[(node1,node2)] --> queue of pairs (comm_id, when the link is released)
-  map<int,Communication> pcomms_id = assignCommunicationIds(pcomms);
-  int clock_cycle = 0;
-  
-  while (!pcomms_id.empty())
-    {      
-      // DEBUG      cout << endl << endl << "cc: " << clock_cycle << endl;
-      
-      for (map<int,Communication>::iterator it = pcomms_id.begin(); it != pcomms_id.end(); )
+      // communications at the front of their link whose release time
+      // has come advance to the next core
+      while (!releases.empty() && releases.top().first <= clock_cycle)
 	{
-	  bool drained = updateLinksOccupation(links_occupation, it->first, it->second, clock_cycle);
-	  /* DEBUG
-	  cout << "\tcomm id " << it->first << ": " << it->second.src_core << "-->" << it->second.dst_core << " (" << it->second.volume << ")" << endl;
-	  cout << "\tlinks occupation:" << endl;
-	  
-	  for (const auto& lo : links_occupation)
-	    {
-	      cout << "\t" << lo.first.first << "-->" << lo.first.second << ": ";
-	      queue<pair<int,int> > q = lo.second;
-	      while (!q.empty())
-		{
-		  cout << "(" << q.front().first << "," << q.front().second << "), ";
-		  q.pop();
-		}
-	      cout << endl;
-	    }
-	  */
-	  
-	  if (drained)
-	    it = pcomms_id.erase(it);
+	  int link = releases.top().second;
+	  releases.pop();
+
+	  int c = link_head[link];
+	  link_head[link] = next_in_link[c];
+	  if (link_head[link] != -1)
+	    releases.push(make_pair(release[link_head[link]], link));
+
+	  curr_core[c] = next_core[c];
+	  if (curr_core[c] == dst_core[c])
+	    active--; // drained
 	  else
-	    ++it;
+	    pending.push_back(c);
 	}
+      sort(pending.begin(), pending.end());
 
-      if (!links_occupation.empty())
-	clock_cycle = nextClockCycle(links_occupation);
+      if (!releases.empty())
+	clock_cycle = releases.top().first;
     }
 
   return clock_cycle * clock_time;
@@ -225,6 +170,8 @@ double NoC::getCommunicationTimeWired(const ParallelCommunications& pcomms) cons
 
 double NoC::getCommunicationTimeWireless(const ParallelCommunications& pcomms) const
 {
+  PROFILE_SCOPE("getCommunicationTimeWireless");
+  
   double ctime = 0.0;
 
   for (Communication comm : pcomms)
@@ -259,23 +206,65 @@ int NoC::linkTraversalCycles(int volume) const
   return ceil((double)volume/link_width);
 }
 
+// Precompute next hop and route length of XY routing for every
+// src/dst pair, so that neither the timing model nor the
+// teleportation path splitter recompute coordinates per hop
+void NoC::buildRouteTable()
+{
+  int ncores = mesh_x * mesh_y;
+  assert(ncores <= numeric_limits<int16_t>::max());
+
+  next_hop.resize(ncores * ncores);
+  hop_count.resize(ncores * ncores);
+  
+  for (int src_core=0; src_core<ncores; src_core++)
+    for (int dst_core=0; dst_core<ncores; dst_core++)
+      {
+	int x, y, xd, yd;
+  
+	getCoreXY(src_core, x, y);
+	getCoreXY(dst_core, xd, yd);
+
+	hop_count[src_core * ncores + dst_core] = abs(x - xd) + abs(y - yd);
+	
+	if (x < xd)
+	  x++;
+	else if (x > xd)
+	  x--;
+	else if (y < yd)
+	  y++;
+	else if (y > yd)
+	  y--;
+
+	next_hop[src_core * ncores + dst_core] = getCoreID(x, y);
+      }
+}
+
 int NoC::routingXY(const int src_core, const int dst_core) const
 {
-  int x, y, xd, yd;
+  return next_hop[src_core * mesh_x * mesh_y + dst_core];
+}
+
+int NoC::getHopCount(const int src_core, const int dst_core) const
+{
+  return hop_count[src_core * mesh_x * mesh_y + dst_core];
+}
+
+// Full XY route from src_core to dst_core, both included
+void NoC::getRouteXY(const int src_core, const int dst_core, vector<int>& path) const
+{
+  int ncores = mesh_x * mesh_y;
   
-  getCoreXY(src_core, x, y);
-  getCoreXY(dst_core, xd, yd);
-
-  if (x < xd)
-    x++;
-  else if (x > xd)
-    x--;
-  else if (y < yd)
-    y++;
-  else if (y > yd)
-    y--;
-
-  return getCoreID(x, y);
+  path.resize(getHopCount(src_core, dst_core) + 1);
+  path[0] = src_core;
+
+  const int16_t* next = &next_hop[dst_core];
+  int core_id = src_core;
+  for (size_t i=1; i<path.size(); i++)
+    {
+      core_id = next[core_id * ncores];
+      path[i] = core_id;
+    }
 }
 
 void NoC::getCoreXY(const int core_id, int& x, int& y) const
@@ -1,13 +1,18 @@
 #ifndef __NOC_H__
 #define __NOC_H__
 
-#include <map>
-#include <queue>
+#include <vector>
+#include <cstdint>
 
 #include "communication.h"
 
 using namespace std;
 
+// Each core has four outgoing mesh links (east, west, north, south)
+// plus a degenerate link used by communications whose source and
+// destination coincide
+#define LINKS_PER_CORE 5
+
 struct NoC
 {
   int    mesh_x, mesh_y;
@@ -23,6 +28,11 @@ struct NoC
   //  double wpacket_time;
   
   bool   winoc;
+
+  // XY route table built once per NoC and indexed by
+  // src_core*number_of_cores+dst_core
+  vector<int16_t> next_hop;  // next core on the route
+  vector<int16_t> hop_count; // length of the route in hops
   
   NoC(int _mesh_x, int _mesh_y, int _link_width, double _hop_time, int _qubits_per_core);
 
@@ -36,19 +46,16 @@ struct NoC
   double getCommunicationTimeWired(const ParallelCommunications& pc) const;
   double getCommunicationTimeWireless(const ParallelCommunications& pc) const;
   
+  void buildRouteTable();
   int routingXY(const int src_core, const int dst_core) const;
+  int getHopCount(const int src_core, const int dst_core) const;
+  void getRouteXY(const int src_core, const int dst_core, vector<int>& path) const;
   void getCoreXY(const int core_id, int& x, int& y) const;
   int getCoreID(const int x, const int y) const;
 
   int linkTraversalCycles(int volume) const;
   double getTransferTime(int volume) const;
-  map<int,Communication> assignCommunicationIds(const ParallelCommunications& pcomms) const;
-  bool commIsInQueue(const int id, const queue<pair<int,int> >& qc) const;
-  int computeStartTime(const queue<pair<int,int> >& qc) const;
-  bool updateLinksOccupation(map<pair<int,int>, queue<pair<int,int> > >& links_occupation,
-			     const int cid, Communication& comm,
-			     const int clock_cycle) const;
-  int nextClockCycle(const map<pair<int,int>, queue<pair<int,int> > >& links_occupation) const;
+  int linkIndex(const int core_id, const int next_core) const;
 
 };
 
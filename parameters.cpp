@@ -17,7 +17,14 @@ void Parameters::display() const
        << "token pass time (s): " << token_pass_time << endl
        << "memory mandwidth (bps): " << memory_bandwidth << endl
        << "bits instruction (bits): " << bits_instruction << endl
-       << "decode time per instruction (s): " << decode_time_per_instruction << endl;
+       << "decode time per instruction (s): " << decode_time_per_instruction << endl
+       << "history checkpoint period (steps): " << history_checkpoint_period << endl
+       << "history checkpoints: " << history_checkpoints << endl
+       << "stream window (slices): " << stream_window << endl
+       << "seed: " << seed << endl
+       << "lookahead window (slices): " << lookahead_window << endl
+       << "rebalance period (slices): " << rebalance_period << endl
+       << "EPR buffer depth (rounds): " << epr_buffer_depth << endl;
 }
 
 bool Parameters::readFromFile(const string& file_name)
@@ -57,6 +64,20 @@ bool Parameters::readFromFile(const string& file_name)
 	iss >> decode_time_per_instruction;
       else if (param == string("stats_detailed"))
 	iss >> stats_detailed;
+      else if (param == string("history_checkpoint_period"))
+	iss >> history_checkpoint_period;
+      else if (param == string("history_checkpoints"))
+	iss >> history_checkpoints;
+      else if (param == string("stream_window"))
+	iss >> stream_window;
+      else if (param == string("seed"))
+	iss >> seed;
+      else if (param == string("lookahead_window"))
+	iss >> lookahead_window;
+      else if (param == string("rebalance_period"))
+	iss >> rebalance_period;
+      else if (param == string("epr_buffer_depth"))
+	iss >> epr_buffer_depth;
       else {
 	cout << "Invalid patameter reading " << file_name
 	     << ": '" << param << "'" << endl;
@@ -128,3 +149,38 @@ void Parameters::updateStatsDetailed(const bool nv)
 {
   stats_detailed = nv;
 }
+
+void Parameters::updateHistoryCheckpointPeriod(const int nv)
+{
+  history_checkpoint_period = nv;
+}
+
+void Parameters::updateHistoryCheckpoints(const int nv)
+{
+  history_checkpoints = nv;
+}
+
+void Parameters::updateStreamWindow(const int nv)
+{
+  stream_window = nv;
+}
+
+void Parameters::updateSeed(const unsigned nv)
+{
+  seed = nv;
+}
+
+void Parameters::updateLookaheadWindow(const int nv)
+{
+  lookahead_window = nv;
+}
+
+void Parameters::updateRebalancePeriod(const int nv)
+{
+  rebalance_period = nv;
+}
+
+void Parameters::updateEPRBufferDepth(const int nv)
+{
+  epr_buffer_depth = nv;
+}
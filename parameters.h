@@ -19,8 +19,15 @@ struct Parameters
   int    bits_instruction; // number of bits used for encoding an instruction
   double decode_time_per_instruction;
   bool   stats_detailed;
+  int    history_checkpoint_period; // steps between full snapshots of the cores history (0: only the initial one)
+  int    history_checkpoints; // snapshots of the cores history kept, older events are dropped (0: all)
+  int    stream_window; // slices read at a time when streaming the circuit (0: load the whole circuit)
+  unsigned seed; // seed of the random generators (0: drawn from the clock)
+  int    lookahead_window; // slices looked ahead by the lookahead destination selection
+  int    rebalance_period; // slices between two rebalancings of the cores (0: never)
+  int    epr_buffer_depth; // rounds of EPR pairs generated ahead by each LTM port (0: none)
   
-  Parameters() : gate_delay(0.0), epr_delay(0.0), dist_delay(0.0), pre_delay(0.0), post_delay(0.0), noc_clock_time(0.0), wbit_rate(0.0), token_pass_time(0.0), memory_bandwidth(0.0), bits_instruction(0), decode_time_per_instruction(0.0) {}
+  Parameters() : gate_delay(0.0), epr_delay(0.0), dist_delay(0.0), pre_delay(0.0), post_delay(0.0), noc_clock_time(0.0), wbit_rate(0.0), token_pass_time(0.0), memory_bandwidth(0.0), bits_instruction(0), decode_time_per_instruction(0.0), history_checkpoint_period(0), history_checkpoints(0), stream_window(0), seed(0), lookahead_window(16), rebalance_period(0), epr_buffer_depth(0) {}
 
   void display() const;
 
@@ -38,6 +45,13 @@ struct Parameters
   void updateBitsInstruction(const int nv);
   void updateDecodeTime(const double nv);
   void updateStatsDetailed(const bool nv);
+  void updateHistoryCheckpointPeriod(const int nv);
+  void updateHistoryCheckpoints(const int nv);
+  void updateStreamWindow(const int nv);
+  void updateSeed(const unsigned nv);
+  void updateLookaheadWindow(const int nv);
+  void updateRebalancePeriod(const int nv);
+  void updateEPRBufferDepth(const int nv);
 
 };
 
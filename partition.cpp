@@ -0,0 +1,377 @@
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <deque>
+#include <limits>
+#include <cassert>
+#include "partition.h"
+
+using namespace std;
+
+#define COARSEN_VERTICES_PER_PART 20   // coarsening stops below nparts times this
+#define COARSEN_MIN_REDUCTION     0.95 // or when a level removes less than 5% of the vertices
+#define REFINE_PASSES             8    // refinement passes per level
+#define BALANCE_PASSES            64   // passes allowed to restore the balance at the end
+
+void InteractionGraphBuilder::addGate(const Gate& gate)
+{
+  for (size_t i=0; i<gate.size(); i++)
+    for (size_t j=i+1; j<gate.size(); j++)
+      {
+	uint32_t a = gate[i], b = gate[j];
+	if (a == b)
+	  continue;
+	if (a > b)
+	  swap(a, b);
+	edges[(uint64_t)a << 32 | b]++;
+      }
+}
+
+void InteractionGraphBuilder::addGates(const GatesView& gates)
+{
+  for (const auto& gate : gates)
+    addGate(gate);
+}
+
+InteractionGraph InteractionGraphBuilder::build(const int nvertices) const
+{
+  InteractionGraph g;
+
+  g.nvertices = nvertices;
+  g.vwgt.assign(nvertices, 1);
+  g.xadj.assign(nvertices + 1, 0);
+  for (const auto& e : edges)
+    {
+      g.xadj[(e.first >> 32) + 1]++;
+      g.xadj[(e.first & 0xffffffff) + 1]++;
+    }
+  for (int v=0; v<nvertices; v++)
+    g.xadj[v+1] += g.xadj[v];
+
+  vector<int> pos(g.xadj.begin(), g.xadj.end() - 1);
+  g.adjncy.resize(g.xadj[nvertices]);
+  g.adjwgt.resize(g.xadj[nvertices]);
+  for (const auto& e : edges)
+    {
+      int a = e.first >> 32, b = e.first & 0xffffffff;
+      g.adjncy[pos[a]] = b;
+      g.adjwgt[pos[a]++] = e.second;
+      g.adjncy[pos[b]] = a;
+      g.adjwgt[pos[b]++] = e.second;
+    }
+
+  return g;
+}
+
+// ----------------------------------------------------------------------
+// Contract the heavy-edge matching of g, visiting the vertices in
+// random order. cmap maps every vertex of g to its coarse vertex.
+static InteractionGraph coarsen(const InteractionGraph& g, const int max_vwgt,
+				mt19937& gen, vector<int>& cmap)
+{
+  int n = g.nvertices;
+  vector<int> perm(n);
+  iota(perm.begin(), perm.end(), 0);
+  shuffle(perm.begin(), perm.end(), gen);
+
+  vector<int> match(n, -1);
+  for (int v : perm)
+    {
+      if (match[v] != -1)
+	continue;
+
+      int best = v, best_w = 0;
+      for (int j=g.xadj[v]; j<g.xadj[v+1]; j++)
+	{
+	  int u = g.adjncy[j];
+	  if (match[u] == -1 && g.vwgt[v] + g.vwgt[u] <= max_vwgt && g.adjwgt[j] > best_w)
+	    {
+	      best = u;
+	      best_w = g.adjwgt[j];
+	    }
+	}
+      match[v] = best;
+      match[best] = v;
+    }
+
+  int nc = 0;
+  cmap.assign(n, -1);
+  for (int v=0; v<n; v++)
+    if (cmap[v] == -1)
+      cmap[v] = cmap[match[v]] = nc++;
+
+  InteractionGraph cg;
+  cg.nvertices = nc;
+  cg.vwgt.assign(nc, 0);
+  cg.xadj.assign(nc + 1, 0);
+  cg.adjncy.reserve(g.adjncy.size());
+  cg.adjwgt.reserve(g.adjwgt.size());
+
+  // the rows are built in coarse vertex order, merging the edges of
+  // the two matched vertices through the position of each neighbour
+  vector<int> slot(nc, -1);
+  for (int v=0; v<n; v++)
+    {
+      if (match[v] < v)
+	continue; // row built from the other vertex of the pair
+
+      int c = cmap[v];
+      size_t row_start = cg.adjncy.size();
+
+      for (int w : {v, match[v]})
+	{
+	  cg.vwgt[c] += g.vwgt[w];
+	  for (int j=g.xadj[w]; j<g.xadj[w+1]; j++)
+	    {
+	      int cu = cmap[g.adjncy[j]];
+	      if (cu == c)
+		continue;
+	      if (slot[cu] == -1)
+		{
+		  slot[cu] = cg.adjncy.size();
+		  cg.adjncy.push_back(cu);
+		  cg.adjwgt.push_back(g.adjwgt[j]);
+		}
+	      else
+		cg.adjwgt[slot[cu]] += g.adjwgt[j];
+	    }
+	  if (match[v] == v)
+	    break;
+	}
+
+      for (size_t j=row_start; j<cg.adjncy.size(); j++)
+	slot[cg.adjncy[j]] = -1;
+      cg.xadj[c+1] = cg.adjncy.size();
+    }
+
+  return cg;
+}
+
+// ----------------------------------------------------------------------
+// Grow the parts one at a time from a seed, always adding the vertex
+// most connected to the part, until the part reaches its share of the
+// total weight
+static vector<int> initialPartition(const InteractionGraph& g, const int nparts, mt19937& gen)
+{
+  int n = g.nvertices;
+  long long total = accumulate(g.vwgt.begin(), g.vwgt.end(), 0LL);
+
+  vector<int> order(n);
+  iota(order.begin(), order.end(), 0);
+  shuffle(order.begin(), order.end(), gen);
+
+  vector<int> part(n, -1), conn(n, 0), touched;
+  size_t next_seed = 0;
+  long long assigned = 0;
+
+  for (int p=0; p<nparts; p++)
+    {
+      long long target = total * (p + 1) / nparts;
+      priority_queue<pair<int,int> > candidates; // (connection to p, vertex)
+
+      while (assigned < target)
+	{
+	  int v = -1;
+	  while (!candidates.empty() && v == -1)
+	    {
+	      pair<int,int> c = candidates.top();
+	      candidates.pop();
+	      if (part[c.second] == -1 && conn[c.second] == c.first)
+		v = c.second;
+	    }
+	  if (v == -1)
+	    {
+	      while (next_seed < order.size() && part[order[next_seed]] != -1)
+		next_seed++;
+	      if (next_seed == order.size())
+		break;
+	      v = order[next_seed];
+	    }
+
+	  part[v] = p;
+	  assigned += g.vwgt[v];
+	  for (int j=g.xadj[v]; j<g.xadj[v+1]; j++)
+	    {
+	      int u = g.adjncy[j];
+	      if (part[u] == -1)
+		{
+		  if (conn[u] == 0)
+		    touched.push_back(u);
+		  conn[u] += g.adjwgt[j];
+		  candidates.push(make_pair(conn[u], u));
+		}
+	    }
+	}
+
+      for (int u : touched)
+	conn[u] = 0;
+      touched.clear();
+    }
+
+  for (int v=0; v<n; v++)
+    if (part[v] == -1)
+      part[v] = nparts - 1;
+
+  return part;
+}
+
+// ----------------------------------------------------------------------
+// Greedy k-way boundary refinement: every vertex is moved to the
+// neighbouring part with the largest positive gain in internal edge
+// weight (or with no loss, if it improves the balance) as long as the
+// target part has room. Vertices of overloaded parts are moved even at
+// a loss, to the lightest part with room if no neighbouring part has.
+static void refine(const InteractionGraph& g, vector<int>& part, const int nparts,
+		   const int max_part_weight, const int max_passes, mt19937& gen)
+{
+  int n = g.nvertices;
+  vector<long long> pweight(nparts, 0);
+  for (int v=0; v<n; v++)
+    pweight[part[v]] += g.vwgt[v];
+
+  vector<int> perm(n);
+  iota(perm.begin(), perm.end(), 0);
+  shuffle(perm.begin(), perm.end(), gen);
+
+  vector<int> connw(nparts, 0), touched;
+
+  for (int pass=0; pass<max_passes; pass++)
+    {
+      int moves = 0;
+
+      for (int v : perm)
+	{
+	  int from = part[v];
+	  int vw = g.vwgt[v];
+	  bool overloaded = pweight[from] > max_part_weight;
+
+	  for (int j=g.xadj[v]; j<g.xadj[v+1]; j++)
+	    {
+	      int q = part[g.adjncy[j]];
+	      if (connw[q] == 0)
+		touched.push_back(q);
+	      connw[q] += g.adjwgt[j];
+	    }
+
+	  int best = -1, best_gain = 0;
+	  for (int q : touched)
+	    {
+	      if (q == from || pweight[q] + vw > max_part_weight)
+		continue;
+	      int gain = connw[q] - connw[from];
+	      if (!overloaded && (gain < 0 || (gain == 0 && pweight[q] + vw >= pweight[from])))
+		continue;
+	      if (best == -1 || gain > best_gain || (gain == best_gain && pweight[q] < pweight[best]))
+		{
+		  best = q;
+		  best_gain = gain;
+		}
+	    }
+
+	  if (overloaded && best == -1)
+	    for (int q=0; q<nparts; q++)
+	      if (q != from && pweight[q] + vw <= max_part_weight &&
+		  (best == -1 || pweight[q] < pweight[best]))
+		best = q;
+
+	  for (int q : touched)
+	    connw[q] = 0;
+	  touched.clear();
+
+	  if (best != -1)
+	    {
+	      part[v] = best;
+	      pweight[from] -= vw;
+	      pweight[best] += vw;
+	      moves++;
+	    }
+	}
+
+      if (moves == 0)
+	break;
+    }
+}
+
+// ----------------------------------------------------------------------
+vector<int> partitionGraph(const InteractionGraph& graph, const int nparts,
+			   const int max_part_weight, mt19937& gen)
+{
+  long long total = accumulate(graph.vwgt.begin(), graph.vwgt.end(), 0LL);
+  assert(total <= (long long)nparts * max_part_weight);
+
+  if (nparts == 1)
+    return vector<int>(graph.nvertices, 0);
+
+  // coarsening, the levels are kept for the projection back
+  int coarsen_to = COARSEN_VERTICES_PER_PART * nparts;
+  int max_vwgt = max(1, min(max_part_weight, (int)(1.5 * total / coarsen_to)));
+  deque<InteractionGraph> levels;
+  vector<vector<int> > cmaps;
+  const InteractionGraph* current = &graph;
+
+  while (current->nvertices > coarsen_to)
+    {
+      vector<int> cmap;
+      InteractionGraph cg = coarsen(*current, max_vwgt, gen, cmap);
+      if (cg.nvertices > COARSEN_MIN_REDUCTION * current->nvertices)
+	break;
+
+      levels.push_back(cg);
+      cmaps.push_back(cmap);
+      current = &levels.back();
+    }
+
+  vector<int> part = initialPartition(*current, nparts, gen);
+  refine(*current, part, nparts, max_part_weight, REFINE_PASSES, gen);
+
+  // uncoarsening
+  for (int l=levels.size()-1; l>=0; l--)
+    {
+      const InteractionGraph& finer = (l == 0) ? graph : levels[l-1];
+      vector<int> fpart(finer.nvertices);
+      for (int v=0; v<finer.nvertices; v++)
+	fpart[v] = part[cmaps[l][v]];
+      part.swap(fpart);
+
+      refine(finer, part, nparts, max_part_weight, REFINE_PASSES, gen);
+    }
+
+  // the vertices of the input graph have unit weight, thus the balance
+  // can always be restored
+  refine(graph, part, nparts, max_part_weight, BALANCE_PASSES, gen);
+
+  vector<long long> pweight = getPartWeights(graph, part, nparts);
+  for (int p=0; p<nparts; p++)
+    if (pweight[p] > max_part_weight)
+      {
+	cerr << "part " << p << " weighs " << pweight[p]
+	     << ", more than the maximum of " << max_part_weight << endl;
+	assert(false);
+      }
+
+  return part;
+}
+
+// ----------------------------------------------------------------------
+vector<long long> getPartWeights(const InteractionGraph& graph, const vector<int>& part,
+				 const int nparts)
+{
+  vector<long long> pweight(nparts, 0);
+  for (int v=0; v<graph.nvertices; v++)
+    pweight[part[v]] += graph.vwgt[v];
+
+  return pweight;
+}
+
+// Every edge is stored at both its ends, thus counted twice
+long long getEdgeCut(const InteractionGraph& graph, const vector<int>& part)
+{
+  long long cut = 0;
+  for (int v=0; v<graph.nvertices; v++)
+    for (int j=graph.xadj[v]; j<graph.xadj[v+1]; j++)
+      if (part[graph.adjncy[j]] != part[v])
+	cut += graph.adjwgt[j];
+
+  return cut / 2;
+}
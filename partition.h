@@ -0,0 +1,46 @@
+#ifndef __PARTITION_H__
+#define __PARTITION_H__
+
+#include <vector>
+#include <unordered_map>
+#include <random>
+#include <cstdint>
+#include "gate.h"
+
+using namespace std;
+
+// Qubit interaction graph in CSR form: the neighbours of qubit v are
+// adjncy[xadj[v]..xadj[v+1]) and adjwgt holds the number of gates
+// acting on both qubits. vwgt is the weight of each vertex (the
+// number of qubits it stands for, 1 unless the graph is coarsened).
+struct InteractionGraph
+{
+  int nvertices;
+  vector<int> xadj, adjncy, adjwgt, vwgt;
+
+  InteractionGraph() : nvertices(0), xadj(1, 0) {}
+};
+
+// Accumulates the pairs of qubits of the gates, then builds the graph
+struct InteractionGraphBuilder
+{
+  unordered_map<uint64_t,int> edges; // (min qubit << 32 | max qubit) -> weight
+
+  void addGate(const Gate& gate);
+  void addGates(const GatesView& gates);
+  InteractionGraph build(const int nvertices) const;
+};
+
+// Multilevel k-way partitioning: heavy-edge matching coarsening, greedy
+// graph growing on the coarsest graph, then projection and greedy
+// boundary refinement at every level. No part exceeds
+// max_part_weight. Returns the part of every vertex.
+vector<int> partitionGraph(const InteractionGraph& graph, const int nparts,
+			   const int max_part_weight, mt19937& gen);
+
+// Weight of every part, and total weight of the edges across parts
+vector<long long> getPartWeights(const InteractionGraph& graph, const vector<int>& part,
+				 const int nparts);
+long long getEdgeCut(const InteractionGraph& graph, const vector<int>& part);
+
+#endif
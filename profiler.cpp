@@ -0,0 +1,111 @@
+#include <sys/resource.h>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include "profiler.h"
+
+using namespace std;
+
+bool Profiler::enabled = false;
+
+struct ProfileEntry
+{
+  long long calls;
+  long long total_ns;
+  long long max_ns;
+
+  ProfileEntry() : calls(0), total_ns(0), max_ns(0) {}
+};
+
+// Timers and counters of a thread, keyed by the address of their name
+struct ProfileTable
+{
+  unordered_map<const char*, ProfileEntry> timers;
+  unordered_map<const char*, long long> counters;
+};
+
+// The tables of all the threads, kept after the threads end
+static mutex tables_mutex;
+static vector<unique_ptr<ProfileTable> > tables;
+
+static ProfileTable& getThreadTable()
+{
+  thread_local ProfileTable* table = NULL;
+
+  if (table == NULL)
+    {
+      lock_guard<mutex> lock(tables_mutex);
+      tables.push_back(unique_ptr<ProfileTable>(new ProfileTable));
+      table = tables.back().get();
+    }
+
+  return *table;
+}
+
+void Profiler::record(const char* name, const long long ns)
+{
+  ProfileEntry& e = getThreadTable().timers[name];
+
+  e.calls++;
+  e.total_ns += ns;
+  if (ns > e.max_ns)
+    e.max_ns = ns;
+}
+
+void Profiler::count(const char* name, const long long n)
+{
+  getThreadTable().counters[name] += n;
+}
+
+long Profiler::getPeakMemoryKB()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  return usage.ru_maxrss; // KB on Linux
+}
+
+void Profiler::display(ostream& os)
+{
+  map<string,ProfileEntry> timers;
+  map<string,long long> counters;
+
+  {
+    lock_guard<mutex> lock(tables_mutex);
+    for (const auto& table : tables)
+      {
+	for (const auto& t : table->timers)
+	  {
+	    ProfileEntry& e = timers[t.first];
+	    e.calls += t.second.calls;
+	    e.total_ns += t.second.total_ns;
+	    e.max_ns = max(e.max_ns, t.second.max_ns);
+	  }
+	for (const auto& c : table->counters)
+	  counters[c.first] += c.second;
+      }
+  }
+
+  os << endl
+     << "*** Profile ***" << endl
+     << left << setw(28) << "phase" << right
+     << setw(12) << "calls" << setw(16) << "total (ms)"
+     << setw(14) << "mean (ns)" << setw(14) << "max (ns)" << endl;
+  for (const auto& t : timers)
+    os << left << setw(28) << t.first << right
+       << setw(12) << t.second.calls
+       << setw(16) << fixed << setprecision(3) << t.second.total_ns/1.0e6
+       << setw(14) << setprecision(0) << (double)t.second.total_ns/t.second.calls
+       << setw(14) << t.second.max_ns << endl;
+  os.unsetf(ios::floatfield);
+  os << setprecision(6);
+
+  for (const auto& c : counters)
+    os << left << setw(28) << c.first << right << setw(12) << c.second << endl;
+  
+  os << "Peak memory (KB): " << getPeakMemoryKB() << endl;
+}
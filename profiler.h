@@ -0,0 +1,49 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+// Opt-in profiler of the phases of a run. Each thread accumulates
+// its timers and counters in its own table; the tables are merged by
+// name when the profile is displayed, after the threads have
+// finished. When disabled, a scope costs a test of Profiler::enabled.
+struct Profiler
+{
+  static bool enabled;
+
+  static void record(const char* name, const long long ns);
+  static void count(const char* name, const long long n = 1);
+
+  static long getPeakMemoryKB();
+  
+  static void display(ostream& os = cerr);
+};
+
+// Times the enclosing scope under name (a string literal)
+struct ProfileScope
+{
+  const char* name;
+  chrono::steady_clock::time_point start;
+
+  ProfileScope(const char* _name) : name(_name)
+  {
+    if (Profiler::enabled)
+      start = chrono::steady_clock::now();
+  }
+
+  ~ProfileScope()
+  {
+    if (Profiler::enabled)
+      Profiler::record(name, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+  }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name)   ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_COUNT(name, n) do { if (Profiler::enabled) Profiler::count(name, n); } while (0)
+
+#endif
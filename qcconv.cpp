@@ -0,0 +1,47 @@
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include "circuit.h"
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+  bool to_text = (argc == 4 && string(argv[1]) == "-t");
+  
+  if (argc != 3 && !to_text)
+    {
+      cerr << "Usage " << argv[0] << " [-t] <input circuit> <output circuit>" << endl
+	   << "Converts a circuit (text or binary) to the binary format, or to the text format with -t" << endl;
+      return 1;
+    }
+
+  string input_fn = argv[argc-2];
+  string output_fn = argv[argc-1];
+
+  // a binary input stays mapped while the output is written, thus it
+  // cannot be overwritten in place
+  struct stat input_st, output_st;
+  if (stat(input_fn.c_str(), &input_st) == 0 && stat(output_fn.c_str(), &output_st) == 0 &&
+      input_st.st_dev == output_st.st_dev && input_st.st_ino == output_st.st_ino)
+    {
+      cerr << "the output circuit file is the input one" << endl;
+      return 4;
+    }
+  
+  Circuit circuit;
+  if (!circuit.readFromFile(input_fn))
+    {
+      cerr << "error reading circuit file" << endl;
+      return 2;
+    }
+
+  bool written = to_text ? circuit.writeTextFile(output_fn) : circuit.writeBinaryFile(output_fn);
+  if (!written)
+    {
+      cerr << "error writing circuit file" << endl;
+      return 3;
+    }
+
+  return 0;
+}
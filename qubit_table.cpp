@@ -0,0 +1,90 @@
+#include <cassert>
+#include <algorithm>
+#include "qubit_table.h"
+
+int QubitTable::getNumberOfQubits() const
+{
+  return qubits.size();
+}
+
+int QubitTable::ancillaIndex(const int qb) const
+{
+  assert(qb < 0);
+
+  return -qb - 1 - ancilla_offset;
+}
+
+void QubitTable::set(const int qb, const int value)
+{
+  assert(value != QT_UNSET);
+  
+  if (qb >= 0)
+    {
+      if (qb >= (int)qubits.size())
+	qubits.resize(qb + 1, QT_UNSET);
+      qubits[qb] = value;
+    }
+  else
+    {
+      int idx = ancillaIndex(qb);
+      if (idx < 0)
+	{
+	  // an ancilla dropped from the front of the pool when it was
+	  // erased, e.g. while moved between cores, is set again
+	  ancillas.insert(ancillas.begin(), -idx, QT_UNSET);
+	  ancilla_offset += idx;
+	  idx = 0;
+	}
+      if (idx >= (int)ancillas.size())
+	ancillas.resize(idx + 1, QT_UNSET);
+      ancillas[idx] = value;
+      ancilla_first = min(ancilla_first, idx);
+    }
+}
+
+// Ancillas are generated with decreasing ids and released roughly in
+// the same order, thus the released ones at the front of the pool are
+// periodically dropped to keep it bounded
+void QubitTable::erase(const int qb)
+{
+  if (!contains(qb))
+    return;
+  
+  if (qb >= 0)
+    {
+      qubits[qb] = QT_UNSET;
+      return;
+    }
+
+  ancillas[ancillaIndex(qb)] = QT_UNSET;
+
+  int nancillas = ancillas.size();
+  while (ancilla_first < nancillas && ancillas[ancilla_first] == QT_UNSET)
+    ancilla_first++;
+
+  if (ancilla_first > nancillas / 2)
+    {
+      ancillas.erase(ancillas.begin(), ancillas.begin() + ancilla_first);
+      ancilla_offset += ancilla_first;
+      ancilla_first = 0;
+    }
+}
+
+bool QubitTable::contains(const int qb) const
+{
+  if (qb >= 0)
+    return qb < (int)qubits.size() && qubits[qb] != QT_UNSET;
+
+  int idx = ancillaIndex(qb);
+  return idx >= 0 && idx < (int)ancillas.size() && ancillas[idx] != QT_UNSET;
+}
+
+int QubitTable::get(const int qb) const
+{
+  assert(contains(qb));
+
+  if (qb >= 0)
+    return qubits[qb];
+  else
+    return ancillas[ancillaIndex(qb)];
+}
@@ -0,0 +1,34 @@
+#ifndef __QUBIT_TABLE_H__
+#define __QUBIT_TABLE_H__
+
+#include <vector>
+
+#define QT_UNSET -1
+
+using namespace std;
+
+// Dense table associating a non-negative value with each qubit. Qubits
+// (ids >= 0) index qubits directly, ancillas (negative ids generated
+// by Cores::generateAncillaId) are kept in a separate pool indexed by
+// -id-1-ancilla_offset.
+struct QubitTable
+{
+  vector<int> qubits;
+  vector<int> ancillas;
+  int ancilla_offset; // number of released ancillas dropped from the front of ancillas
+  int ancilla_first;  // index in ancillas of the oldest ancilla still set
+
+  QubitTable() : ancilla_offset(0), ancilla_first(0) {}
+
+  QubitTable(const vector<int>& values) : qubits(values), ancilla_offset(0), ancilla_first(0) {}
+
+  int getNumberOfQubits() const;
+  int ancillaIndex(const int qb) const;
+
+  void set(const int qb, const int value);
+  void erase(const int qb);
+  bool contains(const int qb) const;
+  int get(const int qb) const;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
 #include <cassert>
+#include <random>
 #include "gate.h"
 #include "circuit.h"
 
@@ -52,10 +53,12 @@ int main(int argc, char* argv[])
   Circuit circuit;
   //  vector<float> prob = {0.5, 0.4, 0.1};
   //circuit.generateCircuit(8, 30, prob);
-  circuit.generateCircuit(nqubits, ngates, prob);
+  random_device rd;
+  mt19937 gen(rd());
+  circuit.generateCircuit(nqubits, ngates, prob, gen);
   
-  for (const auto& parallel_gates : circuit.circuit)
-    displayGates(parallel_gates, true);
+  for (int64_t s=0; s<circuit.number_of_stages; s++)
+    displayGates(circuit.getSlice(s), true);
 
   return 0;
 }
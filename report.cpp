@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <cmath>
+#include <cassert>
+#include "report.h"
+
+using namespace std;
+
+void BufferedWriter::write(const string& s)
+{
+  buffer += s;
+  if (buffer.size() >= BUFFERED_WRITER_SIZE)
+    flush();
+}
+
+void BufferedWriter::flush()
+{
+  os.write(buffer.data(), buffer.size());
+  os.flush();
+  buffer.clear();
+}
+
+// ----------------------------------------------------------------------
+static string formatDouble(const double value)
+{
+  char s[32];
+  snprintf(s, sizeof(s), "%.17g", value);
+
+  return s;
+}
+
+void Report::add(const string& name, const long long value)
+{
+  string s = to_string(value);
+  
+  fields.push_back({name, s, s});
+}
+
+void Report::add(const string& name, const double value)
+{
+  string s = formatDouble(value);
+  
+  // NaN is written without its sign, which is meaningless
+  fields.push_back({name, isfinite(value) ? s : "null", isnan(value) ? "nan" : s});
+}
+
+void Report::add(const string& name, const string& value)
+{
+  string json = "\"", csv = "\"";
+  for (char c : value)
+    {
+      if (c == '"' || c == '\\')
+	json += '\\';
+      json += c;
+      if (c == '"')
+	csv += '"';
+      csv += c;
+    }
+  json += '"';
+  csv += '"';
+
+  fields.push_back({name, json, csv});
+}
+
+void Report::add(const string& name, const vector<int>& values)
+{
+  string json = "[", csv = "\"";
+  for (size_t i=0; i<values.size(); i++)
+    {
+      string s = to_string(values[i]);
+      json += (i ? "," : "") + s;
+      csv += (i ? " " : "") + s;
+    }
+  json += "]";
+  csv += "\"";
+  
+  fields.push_back({name, json, csv});
+}
+
+void Report::add(const string& name, const vector<vector<int> >& values)
+{
+  string json = "[", csv = "\"";
+  for (size_t r=0; r<values.size(); r++)
+    {
+      json += r ? ",[" : "[";
+      csv += r ? ";" : "";
+      for (size_t c=0; c<values[r].size(); c++)
+	{
+	  string s = to_string(values[r][c]);
+	  json += (c ? "," : "") + s;
+	  csv += (c ? " " : "") + s;
+	}
+      json += "]";
+    }
+  json += "]";
+  csv += "\"";
+  
+  fields.push_back({name, json, csv});
+}
+
+// ----------------------------------------------------------------------
+void ReportWriter::write(const Report& report)
+{
+  string line;
+  
+  if (format == OUTPUT_JSON)
+    {
+      line = "{";
+      for (size_t i=0; i<report.fields.size(); i++)
+	line += (i ? ",\"" : "\"") + report.fields[i].name + "\":" + report.fields[i].json;
+      line += "}\n";
+    }
+  else if (format == OUTPUT_CSV)
+    {
+      if (!header_written)
+	{
+	  for (size_t i=0; i<report.fields.size(); i++)
+	    line += (i ? "," : "") + report.fields[i].name;
+	  line += "\n";
+	  header_written = true;
+	}
+      for (size_t i=0; i<report.fields.size(); i++)
+	line += (i ? "," : "") + report.fields[i].csv;
+      line += "\n";
+    }
+  else
+    assert(false);
+
+  writer.write(line);
+}
@@ -0,0 +1,64 @@
+#ifndef __REPORT_H__
+#define __REPORT_H__
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+using namespace std;
+
+#define OUTPUT_TEXT 0
+#define OUTPUT_JSON 1
+#define OUTPUT_CSV  2
+
+#define BUFFERED_WRITER_SIZE (1 << 16)
+
+// Accumulates the output in memory and writes it to the stream in
+// large blocks
+struct BufferedWriter
+{
+  ostream& os;
+  string buffer;
+
+  BufferedWriter(ostream& _os) : os(_os) { buffer.reserve(BUFFERED_WRITER_SIZE); }
+  ~BufferedWriter() { flush(); }
+
+  void write(const string& s);
+  void flush();
+};
+
+// A record is an ordered list of named fields, each one kept already
+// formatted for JSON and for CSV. Non-finite numbers are null in JSON,
+// arrays and matrices are space (and semicolon) separated in CSV.
+struct ReportField
+{
+  string name;
+  string json, csv;
+};
+
+struct Report
+{
+  vector<ReportField> fields;
+
+  void add(const string& name, const long long value);
+  void add(const string& name, const int value) { add(name, (long long)value); }
+  void add(const string& name, const double value);
+  void add(const string& name, const string& value);
+  void add(const string& name, const vector<int>& values);
+  void add(const string& name, const vector<vector<int> >& values);
+};
+
+// Writes reports as JSON (one object per line) or CSV (a header line
+// taken from the first report, then one row per report)
+struct ReportWriter
+{
+  BufferedWriter writer;
+  int format;
+  bool header_written;
+
+  ReportWriter(ostream& os, const int _format) : writer(os), format(_format), header_written(false) {}
+
+  void write(const Report& report);
+};
+
+#endif
@@ -2,13 +2,19 @@
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <algorithm>
 #include "simulation.h"
+#include "profiler.h"
 #include "gate.h"
 #include "communication.h"
 #include "communication_time.h"
+#include "matching.h"
 
 using namespace std;
 
+#define REBALANCE_TOLERANCE 0.1 // a core is overloaded above the average load by more than this
+#define REBALANCE_MIN_GAIN  2   // remote gates saved by a migration, which costs one
+
 // ----------------------------------------------------------------------
 bool Simulation::isLocalGate(const Gate& gate, const Mapping& mapping)
 {
@@ -43,6 +49,7 @@ void Simulation::splitLocalRemoteGates(const ParallelGates& pgates, const Mappin
 Statistics Simulation::localExecution(const ParallelGates& lgates,
 				      const Parameters& params)
 {
+  PROFILE_SCOPE("localExecution");
   Statistics stats;
 
   if (!lgates.empty())
@@ -73,6 +80,8 @@ int Simulation::selectDestinationCore(const Architecture& architecture,
       advance(it, 1);    
       selected_core = mapping.qubit2CoreSafe(*it);
     }
+  else if (architecture.dst_selection_mode == DST_SEL_LOOKAHEAD)
+    selected_core = selectDestinationCoreLookahead(architecture, gate, mapping, cores);
   else
     {
       int min_qb = numeric_limits<int>::max();
@@ -94,6 +103,64 @@ int Simulation::selectDestinationCore(const Architecture& architecture,
   return selected_core;
 }
 
+// ----------------------------------------------------------------------
+// Among the cores of the qubits of gate, choose the one requiring the
+// fewest teleportations, then the one holding most partners of these
+// qubits in the next lookahead window (closer slices weighing more)
+// so that the upcoming gates find their qubits together, then the
+// least loaded. Cores without room for the incoming qubits are
+// skipped unless no core has room.
+int Simulation::selectDestinationCoreLookahead(const Architecture& architecture,
+					       const Gate& gate, const Mapping& mapping, const Cores& cores)
+{
+  int selected_core = -1;
+  int best_moves = 0, best_score = 0, best_load = 0;
+  int64_t last_slice = current_slice + next_use.window;
+  
+  for (const auto& candidate : gate)
+    {
+      int core_id = mapping.qubit2CoreSafe(candidate);
+      int load = cores.cores[core_id].size();
+
+      int moves = 0;
+      for (const auto& qb : gate)
+	if (mapping.qubit2CoreSafe(qb) != core_id)
+	  moves++;
+      
+      if (load + moves >= architecture.qubits_per_core)
+	continue;
+
+      // the partners within gate end up on the selected core anyway
+      int score = 0;
+      for (const auto& qb : gate)
+	for (const QubitUse* use = next_use.upcoming(qb, current_slice);
+	     use != next_use.end(qb) && use->slice <= last_slice; use++)
+	  if (find(gate.begin(), gate.end(), use->partner) == gate.end() &&
+	      mapping.qubit2CoreSafe(use->partner) == core_id)
+	    score += last_slice + 1 - use->slice;
+
+      if (selected_core == -1 || moves < best_moves ||
+	  (moves == best_moves && (score > best_score || (score == best_score && load < best_load))))
+	{
+	  selected_core = core_id;
+	  best_moves = moves;
+	  best_score = score;
+	  best_load = load;
+	}
+    }
+
+  // no core has room, the least loaded is taken
+  if (selected_core == -1)
+    for (const auto& qb : gate)
+      {
+	int core_id = mapping.qubit2CoreSafe(qb);
+	if (selected_core == -1 || cores.cores[core_id].size() < cores.cores[selected_core].size())
+	  selected_core = core_id;
+      }
+  
+  return selected_core;
+}
+
 // ----------------------------------------------------------------------
 // qubits in gate are allocated to dst_core. Both mapping and cores
 // structures are updated accordingly.
@@ -103,21 +170,30 @@ void Simulation::updateMappingAndCores(const Architecture& architecture,
 {
   for (const auto& qb : gate)
     {
-      int src_core = mapping.qubit2core[qb];
+      int src_core = mapping.qubit2CoreSafe(qb);
 
       if (src_core != dst_core)
 	{
-	  mapping.qubit2core[qb] = dst_core;
-	  cores.cores[dst_core].insert(qb);
+	  mapping.mapQubit(qb, dst_core);
+	  cores.moveQubit(qb, src_core, dst_core);
 	  assert((int)cores.cores[dst_core].size() < architecture.qubits_per_core);
-	  
-	  auto it = cores.cores[src_core].find(qb);
-	  assert(it != cores.cores[src_core].end());
-	  cores.cores[src_core].erase(it);
 	}
     }
 }
 
+// ----------------------------------------------------------------------
+// Whether dst_core has room for the qubits of gate mapped elsewhere
+bool Simulation::hasRoom(const Architecture& architecture, const Gate& gate,
+			 const int dst_core, const Mapping& mapping, const Cores& cores)
+{
+  int moves = 0;
+  for (const auto& qb : gate)
+    if (mapping.qubit2CoreSafe(qb) != dst_core)
+      moves++;
+
+  return (int)cores.cores[dst_core].size() + moves < architecture.qubits_per_core;
+}
+
 // ----------------------------------------------------------------------
 // Generate communications from the core where the qubits of gate are
 // mapped onto to the dst_core and insert them into
@@ -163,6 +239,7 @@ void Simulation::addCommunicationTime(CommunicationTime& total_ct,
   total_ct.t_pre  += ct.t_pre;
   total_ct.t_clas += ct.t_clas;
   total_ct.t_post += ct.t_post;
+  total_ct.t_overlap += ct.t_overlap;
 }
 
 // ----------------------------------------------------------------------
@@ -179,6 +256,7 @@ void Simulation::updateRemoteExecutionStats(Statistics& stats,
   stats.intercore_volume += getTotalCommunicationVolume(pcomms);
     
   CommunicationTime comm_time = getCommunicationTime(pcomms, noc, params);
+  comm_time.t_overlap = pipeline.addRound(pcomms, comm_time);
   				       
   addCommunicationTime(stats.communication_time, comm_time);
 
@@ -189,13 +267,133 @@ void Simulation::updateRemoteExecutionStats(Statistics& stats,
 }
 
 // ----------------------------------------------------------------------
-void Simulation::removeExecutedGates(const ParallelGates& scheduled_gates,
+void Simulation::removeExecutedGates(const vector<bool>& scheduled,
 				     ParallelGates& gates)
 {
-  // Remove scheduled_gates from gates
-  gates.remove_if([&scheduled_gates](const Gate &gate) {
-    return std::find(scheduled_gates.begin(), scheduled_gates.end(), gate) != scheduled_gates.end();
-    });
+  // Remove the gates flagged as scheduled. Flags are per position, so
+  // identical gates in the same slice are removed only once each
+  ParallelGates remaining_gates;
+  for (size_t g=0; g<gates.size(); g++)
+    if (!scheduled[g])
+      remaining_gates.push_back(gates[g]);
+
+  gates = remaining_gates;
+}
+
+// ----------------------------------------------------------------------
+// Order in which remoteExecution tries the gates for the next round of
+// teleportations. The greedy policy keeps the list order, and the
+// destination of every gate is selected when it is tried. The matching
+// policy selects the destinations at the start of the round, in
+// dst_cores, and puts first a maximum b-matching of the cores (every
+// core in at most ltm_ports teleportations) over the gates with a
+// single teleportation. The matching is seeded greedily with the gates
+// of the most contended cores first: the augmenting paths keep these
+// cores matched, and the busiest core bounds the number of rounds left.
+// The other gates follow, to fill the ports left. Unless this fits
+// more gates than the list order does, the list order is kept, thus
+// the matching policy never does worse than the greedy one in a round.
+vector<size_t> Simulation::getRoundOrder(const Architecture& architecture, const ParallelGates& gates,
+					 const Mapping& mapping, const Cores& cores,
+					 vector<int>& dst_cores)
+{
+  vector<size_t> order;
+
+  dst_cores.clear();
+  if (architecture.ltm_scheduling != LTM_SCHED_MATCHING)
+    {
+      for (size_t g=0; g<gates.size(); g++)
+	order.push_back(g);
+      return order;
+    }
+
+  // ports used by every gate, one entry for each end of each
+  // teleportation, and number of ports requested from every core
+  int ncores = architecture.number_of_cores;
+  vector<vector<int> > ports(gates.size());
+  vector<int> demand(ncores, 0);
+  for (size_t g=0; g<gates.size(); g++)
+    {
+      int dst_core = selectDestinationCore(architecture, gates[g], mapping, cores);
+      dst_cores.push_back(dst_core);
+      for (const auto& qb : gates[g])
+	{
+	  int src_core = mapping.qubit2CoreSafe(qb);
+	  if (src_core != dst_core)
+	    {
+	      ports[g].push_back(src_core);
+	      ports[g].push_back(dst_core);
+	      demand[src_core]++;
+	      demand[dst_core]++;
+	    }
+	}
+    }
+
+  // takes the ports of gate g if all of them are available
+  auto fit = [&](const size_t g, vector<int>& available) {
+    size_t k = 0;
+    bool fits = true;
+    for (; k<ports[g].size() && fits; k++)
+      fits = (available[ports[g][k]]-- > 0);
+    if (!fits)
+      for (size_t i=0; i<k; i++)
+	available[ports[g][i]]++;
+    return fits;
+  };
+
+  // gates fitted by the list order, as the greedy policy does
+  size_t list_fitted = 0;
+  vector<int> available(ncores, architecture.ltm_ports);
+  for (size_t g=0; g<gates.size(); g++)
+    if (fit(g, available))
+      list_fitted++;
+
+  // greedy seed, the gates of the most contended cores first
+  vector<pair<int,size_t> > by_contention;
+  for (size_t g=0; g<gates.size(); g++)
+    if (ports[g].size() == 2)
+      by_contention.push_back(make_pair(max(demand[ports[g][0]], demand[ports[g][1]]), g));
+  sort(by_contention.rbegin(), by_contention.rend());
+
+  available.assign(ncores, architecture.ltm_ports);
+  vector<pair<int,int> > edges;
+  vector<bool> selected;
+  for (const auto& bc : by_contention)
+    {
+      edges.push_back(make_pair(ports[bc.second][0], ports[bc.second][1]));
+      selected.push_back(fit(bc.second, available));
+    }
+  maximumBMatching(vector<int>(ncores, architecture.ltm_ports), edges, selected);
+
+  // the gates with more teleportations fill the ports left
+  vector<bool> matched(gates.size(), false);
+  size_t matched_gates = 0;
+  available.assign(ncores, architecture.ltm_ports);
+  for (size_t i=0; i<by_contention.size(); i++)
+    if (selected[i])
+      {
+	matched[by_contention[i].second] = true;
+	matched_gates++;
+	fit(by_contention[i].second, available);
+      }
+  for (size_t g=0; g<gates.size(); g++)
+    if (!matched[g] && ports[g].size() > 2 && fit(g, available))
+      {
+	matched[g] = true;
+	matched_gates++;
+      }
+
+  if (matched_gates <= list_fitted)
+    matched.assign(gates.size(), false);
+
+  for (size_t g=0; g<gates.size(); g++)
+    if (matched[g])
+      order.push_back(g);
+  for (size_t g=0; g<gates.size(); g++)
+    if (!matched[g])
+      order.push_back(g);
+  
+  return order;
 }
 
 // ----------------------------------------------------------------------
@@ -204,6 +402,7 @@ Statistics Simulation::remoteExecution(const Architecture& architecture, const N
 				       const ParallelGates& rgates,
 				       Mapping& mapping, Cores& cores)
 {
+  PROFILE_SCOPE("remoteExecution");
   Statistics stats;
 
   if (!rgates.empty())
@@ -215,16 +414,21 @@ Statistics Simulation::remoteExecution(const Architecture& architecture, const N
 	  vector<int> available_ltm_ports(architecture.number_of_cores, architecture.ltm_ports);
 	  ParallelGates parallel_gates;
 	  ParallelCommunications parallel_communications;
+	  vector<bool> scheduled(gates.size(), false);
 	  
+	  vector<int> dst_cores;
 	  bool first_gate_to_map = true;
-	  for (const auto& gate : gates)
+	  for (size_t g : getRoundOrder(architecture, gates, mapping, cores, dst_cores))
 	    {
+	      Gate gate = gates[g];
 	      bool skip_this_gate = false;
-	      int dst_core = selectDestinationCore(architecture, gate, mapping, cores);
+	      int dst_core = dst_cores.empty() ? -1 : dst_cores[g];
+	      if (dst_core == -1 || !hasRoom(architecture, gate, dst_core, mapping, cores))
+		dst_core = selectDestinationCore(architecture, gate, mapping, cores);
 	      vector<int> tmp_available_ltm_ports = available_ltm_ports;
 	      for (const auto& qb : gate)
 		{		  
-		  int src_core = mapping.qubit2core[qb];
+		  int src_core = mapping.qubit2CoreSafe(qb);
 		  if (src_core != dst_core)
 		    {
 		      if (tmp_available_ltm_ports[src_core] && tmp_available_ltm_ports[dst_core])
@@ -250,17 +454,19 @@ Statistics Simulation::remoteExecution(const Architecture& architecture, const N
 					    ceil(log2(2+architecture.qubits_per_core*architecture.number_of_cores))); 
 		  available_ltm_ports = tmp_available_ltm_ports;
 		  parallel_gates.push_back(gate);
+		  scheduled[g] = true;
 		  updateMappingAndCores(architecture, mapping, cores, gate, dst_core);
 		}
 
 	      first_gate_to_map = false;
 
-	    } // for (const auto& gate : gates)
+	    } // for (size_t g : getRoundOrder(...))
 	  
+	  PROFILE_COUNT("remote rounds", 1);
 	  updateRemoteExecutionStats(stats, parallel_gates, parallel_communications,
 				     noc, parameters);
 	  cores.saveHistory();
-	  removeExecutedGates(parallel_gates, gates);
+	  removeExecutedGates(scheduled, gates);
 	} //  while (!gates.empty())
     }
   
@@ -327,12 +533,11 @@ ParallelCommunications Simulation::makeDispatchCommunications(const ParallelGate
       // to determine the target core. The target core cannot be
       // inferred from the gate in general. For the case of
       // teleportation_type == MESH the target core is that hosting
-      // the qubit in the secon input of the gate.
+      // the qubit in the secon input of the gate, or in the only
+      // input of a single-qubit gate.
       
       assert(g.size() <= 2);
-      auto it = g.begin(); 
-      advance(it, 1);    
-      int qb = *it;      
+      int qb = g[g.size()-1];
       int dst_core = mapping.qubit2CoreSafe(qb);
       Communication comm(0, dst_core, volume);
       pc.push_back(comm);
@@ -394,98 +599,269 @@ Statistics Simulation::simulate(const ParallelGates& pgates, const Architecture&
 }
 
 // ----------------------------------------------------------------------
-void Simulation::freeAncillas(const set<int>& ancilla, Mapping& mapping, Cores& cores)
+void Simulation::freeAncillas(const vector<int>& ancillas, Mapping& mapping, Cores& cores)
 {
-  for (int qba : ancilla)
+  for (int qba : ancillas)
     {
       int core_id = mapping.qubit2CoreSafe(qba);
 
-      cores.cores[core_id].erase(qba);
-      mapping.qubit2core.erase(qba);
+      cores.freeAncilla(core_id, qba, mapping);
     }
 }
 
 // ----------------------------------------------------------------------
-void Simulation::removeUsedAncillas(set<int>& ancillas, const ParallelGates& pg)
+// Simulate a slice of the circuit and accumulate its statistics
+void Simulation::simulateSlice(const GatesView& slice, const Architecture& architecture,
+			       const NoC& noc, const Parameters& parameters,
+			       Mapping& mapping, Cores& cores, Statistics& global_stats)
 {
-  for (const auto& gate : pg) {
-    for (int qb : gate) {
-      ancillas.erase(qb);
+  PROFILE_COUNT("slices", 1);
+  
+  // the slice is expanded in a sequence of slices when not
+  // all-to-all connectivity is used for teleportation
+  vector<vector<int> > ancillas_last_use;
+  list<ParallelGates> slices = FixParallelGates(slice, architecture,
+						noc, mapping, cores, ancillas_last_use);
+
+  PROFILE_COUNT("expanded slices", slices.size());
+
+  size_t k = 0;
+  for (list<ParallelGates>::const_iterator it_pgates = slices.begin();
+       it_pgates != slices.end(); it_pgates++, k++)
+    {
+      Statistics stats = simulate(*it_pgates, architecture, noc,
+				  parameters, mapping, cores);
+
+      // the ancillas are not referred after their last use thus
+      // they can be released
+      if (k < ancillas_last_use.size())
+	freeAncillas(ancillas_last_use[k], mapping, cores);
+      
+      double th = noc.getThroughput(stats.intercore_volume,
+				    stats.communication_time.getTotalTime());
+
+      global_stats.updateStatistics(stats, th);
+
+      // the EPR pairs of the next rounds are generated meanwhile
+      pipeline.advance(stats.getExecutionTime() - stats.communication_time.getTotalTime());
     }
-  }
 }
 
 // ----------------------------------------------------------------------
-set<int> Simulation::getAncillas(const ParallelGates& pg)
+// Simulate the entire circuit
+Statistics Simulation::simulate(const Circuit& circuit, const Architecture& architecture,
+				const NoC& noc, const Parameters& parameters,
+				Mapping& mapping, Cores& cores)
 {
-  set<int> ancillas;
+  PROFILE_SCOPE("simulate");
+  Statistics global_stats;
 
-  for (const auto& gate : pg)
-    for (int qb : gate)
-      if (qb < 0)
-	ancillas.insert(qb);
-  
-  return ancillas;
-}
+  cores.saveHistory(); // save the initial state of the cores
+  pipeline.reset(parameters.epr_buffer_depth, architecture.number_of_cores, architecture.ltm_ports);
 
-// ----------------------------------------------------------------------
-// Remove the ancillas used in the current slice if they are not
-// referred in subsequent slices
-void Simulation::freeUnusedAncillas(list<ParallelGates>::iterator it_pgates,
-				    const list<ParallelGates>& circuit,
-				    Mapping& mapping, Cores& cores)
-{
-    
-  set<int> ancillas = getAncillas(*it_pgates);
+  if (architecture.dst_selection_mode == DST_SEL_LOOKAHEAD || parameters.rebalance_period > 0)
+    next_use.build(circuit, parameters.lookahead_window);
   
-  it_pgates++;
-  while (it_pgates != circuit.end() && !ancillas.empty())
+  for (current_slice=0; current_slice<circuit.number_of_stages; current_slice++)
     {
-      removeUsedAncillas(ancillas, *it_pgates);
-      it_pgates++;
+      simulateSlice(circuit.getSlice(current_slice), architecture, noc, parameters,
+		    mapping, cores, global_stats);
+
+      // no rebalancing after the last slice
+      if (parameters.rebalance_period > 0 && (current_slice + 1) % parameters.rebalance_period == 0 &&
+	  current_slice + 1 < circuit.number_of_stages)
+	rebalanceCores(architecture, noc, parameters, mapping, cores, global_stats);
     }
-  
-  // The qubits into ancillas are not used thus they can be released
-  freeAncillas(ancillas, mapping, cores);
+
+  return global_stats;
 }
 
 // ----------------------------------------------------------------------
-// Simulate the entire circuit
-Statistics Simulation::simulate(const Circuit& circuit, const Architecture& architecture,
+// Simulate the circuit read from the stream, one window of slices at
+// a time. Only the current window is held in memory, thus the
+// lookahead does not see past the end of the window.
+Statistics Simulation::simulate(CircuitStream& stream, const Architecture& architecture,
 				const NoC& noc, const Parameters& parameters,
 				Mapping& mapping, Cores& cores)
 {
+  PROFILE_SCOPE("simulate");
   Statistics global_stats;
+  Circuit window;
 
   cores.saveHistory(); // save the initial state of the cores
+  pipeline.reset(parameters.epr_buffer_depth, architecture.number_of_cores, architecture.ltm_ports);
   
-  // make a copy of the circuit that might be modified when not all-to-all connectivity is used for teleportation
-  list<ParallelGates> lcircuit = circuit.circuit;
+  int64_t first_slice = 0; // index in the circuit of the first slice of the window
   
-  for (list<ParallelGates>::iterator it_pgates = lcircuit.begin();
-       it_pgates != lcircuit.end(); it_pgates++)
+  while (stream.readSlices(window, parameters.stream_window))
     {
-      ParallelGates parallel_gates = FixParallelGatesAndUpdateCircuit(it_pgates, lcircuit,
-								      architecture, mapping, cores);
-      Statistics stats = simulate(parallel_gates, architecture, noc,
-				  parameters, mapping, cores);
-            
-      freeUnusedAncillas(it_pgates, lcircuit, mapping, cores);
+      if (architecture.dst_selection_mode == DST_SEL_LOOKAHEAD || parameters.rebalance_period > 0)
+	next_use.build(window, parameters.lookahead_window);
       
-      double th = noc.getThroughput(stats.intercore_volume,
-				    stats.communication_time.getTotalTime());
+      for (current_slice=0; current_slice<window.number_of_stages; current_slice++)
+	{
+	  simulateSlice(window.getSlice(current_slice), architecture, noc, parameters,
+			mapping, cores, global_stats);
 
-      global_stats.updateStatistics(stats, th);
-      
+	  int64_t simulated = first_slice + current_slice + 1;
+	  if (parameters.rebalance_period > 0 && simulated % parameters.rebalance_period == 0 &&
+	      simulated < stream.number_of_stages)
+	    rebalanceCores(architecture, noc, parameters, mapping, cores, global_stats);
+	}
+      first_slice += window.number_of_stages;
     }
 
   return global_stats;
 }
 
+// ----------------------------------------------------------------------
+// Count in affinity[core] the upcoming gates of qb in the lookahead
+// window whose partner is mapped onto core. The cores with a non-zero
+// affinity are appended to touched.
+void Simulation::getPartnerAffinity(const int qb, const Mapping& mapping,
+				    vector<int>& affinity, vector<int>& touched)
+{
+  int64_t last_slice = current_slice + next_use.window;
+  
+  for (const QubitUse* use = next_use.upcoming(qb, current_slice);
+       use != next_use.end(qb) && use->slice <= last_slice; use++)
+    {
+      int core_id = mapping.qubit2CoreSafe(use->partner);
+      if (affinity[core_id] == 0)
+	touched.push_back(core_id);
+      affinity[core_id]++;
+    }
+}
+
+// ----------------------------------------------------------------------
+// Migrate qubits out of the cores loaded above the average by more
+// than REBALANCE_TOLERANCE, at most down to that threshold. A qubit
+// only leaves for a core where at least REBALANCE_MIN_GAIN more of its
+// gates in the lookahead window find their partner than on its own
+// core, thus every migration saves more remote gates than the
+// teleportation it costs; the largest gains go first. A destination
+// is kept below the average load (and its capacity), so that it is not
+// overloaded in turn. The migrations are teleported in rounds limited
+// by the LTM ports, and accounted as intercore communications. The
+// migrations are direct teleportations between the two cores, thus
+// only all-to-all teleportation is supported (see checkParameters).
+void Simulation::rebalanceCores(const Architecture& architecture, const NoC& noc,
+				const Parameters& parameters, Mapping& mapping, Cores& cores,
+				Statistics& global_stats)
+{
+  assert(architecture.teleportation_type == TP_TYPE_A2A);
+  
+  PROFILE_SCOPE("rebalanceCores");
+  int ncores = architecture.number_of_cores;
+  vector<int> load(ncores);
+  int total_load = 0;
+  for (int c=0; c<ncores; c++)
+    {
+      load[c] = cores.cores[c].size();
+      total_load += load[c];
+    }
+  int target = ceil((double)total_load / ncores);
+  int overloaded = max(target, (int)floor((1.0 + REBALANCE_TOLERANCE) * total_load / ncores));
+
+  // load of a destination after the migration
+  int max_dst_load = min(target, architecture.qubits_per_core) - 1;
+  
+  // plan the migrations
+  vector<pair<int,int> > migrations; // (qubit, destination core)
+  vector<int> affinity(ncores, 0), touched;
+  for (int c=0; c<ncores; c++)
+    {
+      if (load[c] <= overloaded)
+	continue;
+
+      // best gain of every qubit of c over the possible destinations
+      vector<pair<int,int> > candidates; // (-gain, qubit)
+      for (int qb : cores.cores[c])
+	{
+	  getPartnerAffinity(qb, mapping, affinity, touched);
+	  int gain = 0;
+	  for (int t : touched)
+	    if (t != c && load[t] + 1 <= max_dst_load)
+	      gain = max(gain, affinity[t] - affinity[c]);
+	  if (gain >= REBALANCE_MIN_GAIN)
+	    candidates.push_back(make_pair(-gain, qb));
+	  for (int t : touched)
+	    affinity[t] = 0;
+	  touched.clear();
+	}
+      sort(candidates.begin(), candidates.end());
+
+      // the destinations are chosen again as the loads change
+      for (size_t i=0; i<candidates.size() && load[c] > overloaded; i++)
+	{
+	  int qb = candidates[i].second;
+	  getPartnerAffinity(qb, mapping, affinity, touched);
+
+	  int dst_core = -1;
+	  for (int d : touched)
+	    if (d != c && load[d] + 1 <= max_dst_load && affinity[d] - affinity[c] >= REBALANCE_MIN_GAIN &&
+		(dst_core == -1 || affinity[d] > affinity[dst_core] ||
+		 (affinity[d] == affinity[dst_core] && load[d] < load[dst_core])))
+	      dst_core = d;
+	  
+	  for (int t : touched)
+	    affinity[t] = 0;
+	  touched.clear();
+
+	  if (dst_core == -1)
+	    continue;
+	  
+	  migrations.push_back(make_pair(qb, dst_core));
+	  load[c]--;
+	  load[dst_core]++;
+	}
+    }
+
+  // teleport them
+  Statistics stats;
+  int volume = ceil(log2(2+architecture.qubits_per_core*architecture.number_of_cores));
+  while (!migrations.empty())
+    {
+      vector<int> available_ltm_ports(ncores, architecture.ltm_ports);
+      ParallelCommunications parallel_communications;
+      vector<pair<int,int> > postponed;
+      
+      for (const auto& m : migrations)
+	{
+	  int src_core = mapping.qubit2CoreSafe(m.first);
+	  if (available_ltm_ports[src_core] && available_ltm_ports[m.second])
+	    {
+	      available_ltm_ports[src_core]--;
+	      available_ltm_ports[m.second]--;
+	      parallel_communications.push_back(Communication(src_core, m.second, volume));
+	      mapping.mapQubit(m.first, m.second);
+	      cores.moveQubit(m.first, src_core, m.second);
+	    }
+	  else
+	    postponed.push_back(m);
+	}
+
+      stats.migrated_qubits += parallel_communications.size();
+      stats.intercore_comms += parallel_communications.size();
+      stats.intercore_volume += getTotalCommunicationVolume(parallel_communications);
+      CommunicationTime comm_time = getCommunicationTime(parallel_communications, noc, parameters);
+      comm_time.t_overlap = pipeline.addRound(parallel_communications, comm_time);
+      addCommunicationTime(stats.communication_time, comm_time);
+      cores.saveHistory();
+      migrations.swap(postponed);
+    }
+
+  if (stats.migrated_qubits > 0)
+    {
+      double th = noc.getThroughput(stats.intercore_volume,
+				    stats.communication_time.getTotalTime());
+      global_stats.updateStatistics(stats, th);
+    }
+}
+
 // ----------------------------------------------------------------------
 vector<int> Simulation::computeTPPathMesh(const int qubit_src, const int qubit_dst,
-					  const Architecture& architecture,
-					  const Mapping& mapping)
+					  const NoC& noc, const Mapping& mapping)
 {
   vector<int> path;
   
@@ -493,28 +869,7 @@ vector<int> Simulation::computeTPPathMesh(const int qubit_src, const int qubit_d
   int dst_core = mapping.qubit2CoreSafe(qubit_dst);
   
   // XY routing
-  int xs = src_core % architecture.mesh_x;
-  int ys = src_core / architecture.mesh_x;
-  int xd = dst_core % architecture.mesh_x;
-  int yd = dst_core / architecture.mesh_x;
-
-  path.push_back(src_core);
-  int x = xs;
-  int y = ys;
-  while (x != xd || y != yd)
-    {
-      if (x < xd)
-	x++;
-      else if (x > xd)
-	x--;
-      else if (y < yd)
-	y++;
-      else if (y > yd)
-	y--;
-
-      int curr_core = y * architecture.mesh_x + x;
-      path.push_back(curr_core);
-    }
+  noc.getRouteXY(src_core, dst_core, path);
 
   return path;
 }
@@ -523,11 +878,11 @@ vector<int> Simulation::computeTPPathMesh(const int qubit_src, const int qubit_d
 // Computhe the path from source qubit to destination qubit based on
 // the current teleportation type
 vector<int> Simulation::computeTPPath(const int qubit_src, const int qubit_dst,
-				      const Architecture& architecture,
+				      const Architecture& architecture, const NoC& noc,
 				      const Mapping& mapping)
 {
   if (architecture.teleportation_type == TP_TYPE_MESH)
-    return computeTPPathMesh(qubit_src, qubit_dst, architecture, mapping);
+    return computeTPPathMesh(qubit_src, qubit_dst, noc, mapping);
   else
     assert(false);
 }
@@ -552,10 +907,14 @@ int Simulation::allocateAncilla(const int core_id,
 // This method splits a remote gate into a sequence of remote gates
 // involving qubits located in directly connected cores. As new qubits
 // (ancilla qubits) are allocated, the mapping and core structures are
-// updated accordingly.
+// updated accordingly. Each ancilla is referred only by the gate
+// that teleports to it, which is scheduled in the slice of index equal
+// to its position in the sequence: the ancilla is recorded in
+// ancillas_last_use at that index.
 ParallelGates Simulation::splitRemoteGate(const Gate& gate,
-					  const Architecture& architecture,
-					  Mapping& mapping, Cores& cores)
+					  const Architecture& architecture, const NoC& noc,
+					  Mapping& mapping, Cores& cores,
+					  vector<vector<int> >& ancillas_last_use)
 {
   assert(gate.size() == 2); // currently supported only two-input remote gates
 
@@ -569,7 +928,7 @@ ParallelGates Simulation::splitRemoteGate(const Gate& gate,
   ++it;
   int qubit_dst = *it;
   
-  vector<int> path = computeTPPath(qubit_src, qubit_dst, architecture, mapping);
+  vector<int> path = computeTPPath(qubit_src, qubit_dst, architecture, noc, mapping);
 
   int next_qubit;
   for (size_t i=1; i<path.size(); i++)
@@ -579,7 +938,13 @@ ParallelGates Simulation::splitRemoteGate(const Gate& gate,
       if (i == path.size()-1) // next_core is the last core in the path
 	next_qubit = qubit_dst;
       else
-	next_qubit = allocateAncilla(next_core, architecture, mapping, cores);
+	{
+	  next_qubit = allocateAncilla(next_core, architecture, mapping, cores);
+
+	  if (ancillas_last_use.size() < i)
+	    ancillas_last_use.resize(i);
+	  ancillas_last_use[i-1].push_back(next_qubit);
+	}
 
       pg.push_back({qubit_src, next_qubit});
     }
@@ -596,13 +961,15 @@ ParallelGates Simulation::splitRemoteGate(const Gate& gate,
 // the expansion of a remote gate into a sequence of remote gates
 // involving qubits belonging to connected cores
 list<ParallelGates> Simulation::splitRemoteGates(const ParallelGates& rgates,
-						 const Architecture& architecture,
-						 Mapping& mapping, Cores& cores)
+						 const Architecture& architecture, const NoC& noc,
+						 Mapping& mapping, Cores& cores,
+						 vector<vector<int> >& ancillas_last_use)
 {
   list<ParallelGates> pgates_list;
   
   for (const auto& gate : rgates)
-    pgates_list.push_back(splitRemoteGate(gate, architecture, mapping, cores));
+    pgates_list.push_back(splitRemoteGate(gate, architecture, noc, mapping, cores,
+					  ancillas_last_use));
     
   return pgates_list;
 }
@@ -626,59 +993,40 @@ list<ParallelGates> Simulation::sequenceParallelGates(const ParallelGates& lgate
     {
       for (const auto& row : pgates_list_par)
 	{
-	  auto it_row = row.begin();
 	  if (col < row.size())
-	    {
-	      advance(it_row, col);
-	      it_out->push_back(*it_row);
-	    }
+	    it_out->push_back(row[col]);
 	}
     }
 
 
-  slices.front().insert(slices.front().end(), lgates.begin(), lgates.end());
+  slices.front().append(lgates);
       
   return slices;
 }
 
-// ----------------------------------------------------------------------
-// replace the ParallelGates in the circuit pointed by it_pgates with
-// the pgates_list_seq and return the first ParallelGate in the list
-ParallelGates Simulation::insertSequenceParallelGates(list<ParallelGates>::iterator& it_pgates,
-						      list<ParallelGates>& circuit,
-						      const list<ParallelGates>& pgates_list_seq)
-{
-
-  it_pgates = circuit.erase(it_pgates);
-  it_pgates = circuit.insert(it_pgates, pgates_list_seq.begin(), pgates_list_seq.end());
-  
-  return *it_pgates;
-}
-
 // ----------------------------------------------------------------------
 // This method applies only when teleportation connectivity is not
 // all-to-all. In this case the execution of a remote gate is splitted
 // in the execution of different teleportation aimed at moving one of
-// the involved qubits from source to destination. The circuit is
-// updated accordingly to accommodate the additional introduced slices
-ParallelGates Simulation::FixParallelGatesAndUpdateCircuit(list<ParallelGates>::iterator& it_pgates,
-							   list<ParallelGates>& circuit,
-							   const Architecture& architecture,
-							   Mapping& mapping, Cores& cores)
+// the involved qubits from source to destination. The slice is
+// returned as the sequence of slices accommodating the additional
+// teleportations, and ancillas_last_use[k] lists the ancillas that
+// can be released once the k-th slice has been executed.
+list<ParallelGates> Simulation::FixParallelGates(const ParallelGates& pgates,
+						 const Architecture& architecture, const NoC& noc,
+						 Mapping& mapping, Cores& cores,
+						 vector<vector<int> >& ancillas_last_use)
 {
-  ParallelGates pgates = *it_pgates;
-
+  PROFILE_SCOPE("FixParallelGates");
+  
   if (architecture.teleportation_type == TP_TYPE_A2A)
-    return pgates; 
+    return {pgates}; 
 
   ParallelGates lgates, rgates;
   splitLocalRemoteGates(pgates, mapping, lgates, rgates);
   
-  list<ParallelGates> pgates_list_par = splitRemoteGates(rgates, architecture, mapping, cores);
-  
-  list<ParallelGates> pgates_list_seq = sequenceParallelGates(lgates, pgates_list_par);
-
-  ParallelGates pg = insertSequenceParallelGates(it_pgates, circuit, pgates_list_seq);
+  list<ParallelGates> pgates_list_par = splitRemoteGates(rgates, architecture, noc, mapping, cores,
+								  ancillas_last_use);
   
-  return pg;
+  return sequenceParallelGates(lgates, pgates_list_par);
 }
@@ -1,16 +1,25 @@
 #ifndef __SIMULATION_H__
 #define __SIMULATION_H__
 
+#include <list>
 #include "architecture.h"
 #include "core.h"
 #include "circuit.h"
+#include "circuit_stream.h"
 #include "mapping.h"
 #include "statistics.h"
 #include "noc.h"
 #include "parameters.h"
+#include "next_use.h"
 
 struct Simulation
 {
+  NextUseTable next_use; // only built for the lookahead destination selection
+  int64_t current_slice; // index of the slice simulated in the current block
+  EPRPipeline pipeline; // EPR buffers of the LTM ports, kept across the slices
+
+  Simulation() : current_slice(0) {}
+
   bool isLocalGate(const Gate& gate, const Mapping& mapping);
   void splitLocalRemoteGates(const ParallelGates& pgates, const Mapping& mapping,
 			     ParallelGates& lgates, ParallelGates& rgates);
@@ -18,6 +27,10 @@ struct Simulation
 			    const Parameters& params);
   int selectDestinationCore(const Architecture& architecture,
 			    const Gate& gate, const Mapping& mapping, const Cores& cores);
+  int selectDestinationCoreLookahead(const Architecture& architecture,
+				     const Gate& gate, const Mapping& mapping, const Cores& cores);
+  bool hasRoom(const Architecture& architecture, const Gate& gate,
+	       const int dst_core, const Mapping& mapping, const Cores& cores);
   void updateMappingAndCores(const Architecture& architecture,
 			     Mapping& mapping, Cores& cores,
 			     const Gate& gate, const int dst_core);
@@ -35,9 +48,12 @@ struct Simulation
 				  const ParallelCommunications& pcomms,
 				  const NoC& noc,
 				  const Parameters& params);
-  void removeExecutedGates(const ParallelGates& scheduled_gates,
+  void removeExecutedGates(const vector<bool>& scheduled,
 			   ParallelGates& gates);
 
+  vector<size_t> getRoundOrder(const Architecture& architecture, const ParallelGates& gates,
+			       const Mapping& mapping, const Cores& cores,
+			       vector<int>& dst_cores);
   Statistics remoteExecution(const Architecture& architecture, const NoC& noc,
 			     const Parameters& parameters,
 			     const ParallelGates& rgates,
@@ -66,41 +82,46 @@ struct Simulation
   Statistics simulate(const ParallelGates& pgates, const Architecture& architecture,
 		      const NoC& noc, const Parameters& parameters,
 		      Mapping& mapping, Cores& cores);
+  void simulateSlice(const GatesView& slice, const Architecture& architecture,
+		     const NoC& noc, const Parameters& parameters,
+		     Mapping& mapping, Cores& cores, Statistics& global_stats);
   Statistics simulate(const Circuit& circuit, const Architecture& architecture,
 		      const NoC& noc, const Parameters& parameters,
 		      Mapping& mapping, Cores& cores);
+  Statistics simulate(CircuitStream& stream, const Architecture& architecture,
+		      const NoC& noc, const Parameters& parameters,
+		      Mapping& mapping, Cores& cores);
 
   vector<int> computeTPPathMesh(const int qubit_src, const int qubit_dst,
-				const Architecture& architecture,
-				const Mapping& mapping);
+				const NoC& noc, const Mapping& mapping);
   vector<int> computeTPPath(const int qubit_src, const int qubit_dst,
-			    const Architecture& architecture,
+			    const Architecture& architecture, const NoC& noc,
 			    const Mapping& mapping);
   int allocateAncilla(const int core_id,
 		      const Architecture& architecture,
 		      Mapping& mapping, Cores& cores);
   ParallelGates splitRemoteGate(const Gate& gate,
-				const Architecture& architecture,
-				Mapping& mapping, Cores& cores);
+				const Architecture& architecture, const NoC& noc,
+				Mapping& mapping, Cores& cores,
+				vector<vector<int> >& ancillas_last_use);
   list<ParallelGates> splitRemoteGates(const ParallelGates& rgates,
-				       const Architecture& architecture,
-				       Mapping& mapping, Cores& cores);
+				       const Architecture& architecture, const NoC& noc,
+				       Mapping& mapping, Cores& cores,
+				       vector<vector<int> >& ancillas_last_use);
   list<ParallelGates> sequenceParallelGates(const ParallelGates& lgates,
 					    const list<ParallelGates>& pgates_list_par);
-  ParallelGates insertSequenceParallelGates(list<ParallelGates>::iterator& it_pgates,
-					    list<ParallelGates>& circuit,
-					    const list<ParallelGates>& pgates_list_seq);
-  ParallelGates FixParallelGatesAndUpdateCircuit(list<ParallelGates>::iterator& it_pgates,
-						 list<ParallelGates>& circuit,
-						 const Architecture& architecture,
-						 Mapping& mapping, Cores& cores);
+  list<ParallelGates> FixParallelGates(const ParallelGates& pgates,
+				       const Architecture& architecture, const NoC& noc,
+				       Mapping& mapping, Cores& cores,
+				       vector<vector<int> >& ancillas_last_use);
+
+  void freeAncillas(const vector<int>& ancillas, Mapping& mapping, Cores& cores);
 
-  void freeUnusedAncillas(list<ParallelGates>::iterator it_pgates,
-			  const list<ParallelGates>& circuit,
-			  Mapping& mapping, Cores& cores);
-  set<int> getAncillas(const ParallelGates& pg);
-  void removeUsedAncillas(set<int>& ancillas, const ParallelGates& pg);
-  void freeAncillas(const set<int>& ancilla, Mapping& mapping, Cores& cores);
+  void getPartnerAffinity(const int qb, const Mapping& mapping,
+			  vector<int>& affinity, vector<int>& touched);
+  void rebalanceCores(const Architecture& architecture, const NoC& noc,
+		      const Parameters& parameters, Mapping& mapping, Cores& cores,
+		      Statistics& global_stats);
 
 };
 
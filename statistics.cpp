@@ -12,6 +12,7 @@ Statistics::Statistics()
   executed_gates = 0;
   intercore_comms = 0;
   intercore_volume = 0;
+  migrated_qubits = 0;
   computation_time = 0.0;
   avg_throughput = 0.0;
   max_throughput = 0.0;
@@ -22,49 +23,15 @@ Statistics::Statistics()
 }
 
 
+// The number of teleportations between each pair of cores is
+// accumulated by Cores::moveQubit as the simulation goes
 int Statistics::countCommunications(const Cores& cores, const int src, const int dst)
 {
-  int n = 0;
-  
-  for (list<vector<Core> >::const_iterator it_curr = cores.history.begin();
-       it_curr != cores.history.end(); ++it_curr)
-    {
-      list<vector<Core> >::const_iterator it_next = next(it_curr);
-      if (it_next != cores.history.end())
-	{
-	  Core core_src = (*it_curr)[src];
-	  Core core_dst = (*it_next)[dst];
-
-	  vector<int> intersection;
-	  set_intersection(core_src.begin(), core_src.end(),
-			   core_dst.begin(), core_dst.end(),
-			   inserter(intersection, intersection.begin()));
-
-	  n += intersection.size();
-	}
-    }
-  
-  return n;
+  return cores.getIntercoreCommunications(src, dst);
 }
 
 vector<vector<int> > Statistics::getIntercoreCommunications(const Cores& cores)
 {
-  /*
-  int t = 0;
-  for (const auto& vcores : cores.history)
-    {
-      cout << "time " << t++ << endl;
-      for (int i=0; i<vcores.size(); i++)
-	{
-	  cout << "core " << i << ": ";
-	  for (int q : vcores[i])
-	    cout << q << ", ";
-	  cout << endl;
-	}
-      cout << endl;
-    }
-  */
-  
   int ncores = cores.cores.size();
   vector<vector<int> > icc(ncores, vector<int>(ncores, 0)); // icc[s][d] = number of communications from s to d 
 
@@ -76,7 +43,7 @@ vector<vector<int> > Statistics::getIntercoreCommunications(const Cores& cores)
   return icc;
 }
 
-void Statistics::displayIntercoreCommunications(const Cores& cores)
+void Statistics::displayIntercoreCommunications(const Cores& cores, ostream& os)
 {
   vector<vector<int> > icc = getIntercoreCommunications(cores);
 
@@ -85,8 +52,8 @@ void Statistics::displayIntercoreCommunications(const Cores& cores)
   for (int s=0; s<ncores; s++)
     {
       for (int d=0; d<ncores; d++)
-	cout << icc[s][d] << " ";
-      cout << endl;
+	os << icc[s][d] << " ";
+      os << endl;
     }
 }
 
@@ -94,125 +61,150 @@ vector<int> Statistics::getOperationsPerQubit(const Circuit& circuit)
 {
   vector<int> opsqb(circuit.number_of_qubits, 0);
 
-  for (ParallelGates pg : circuit.circuit)
-    for (Gate g : pg)
-      for (int qb : g)
-	opsqb[qb]++;
+  for (const auto& gate : circuit.getGates())
+    for (int qb : gate)
+      opsqb[qb]++;
 
   return opsqb;
 }
 
-void Statistics::displayOperationsPerQubit(const Circuit& circuit)
+void Statistics::displayOperationsPerQubit(const vector<int>& opsqb, ostream& os)
 {
-  vector<int> opsqb = getOperationsPerQubit(circuit);
-
   for (int ops : opsqb)
-    cout << ops << ", ";
-  cout << endl;
-}
-
-// return core idx where qb is located. -1 if not found
-int Statistics::qbitToCore(const int qb, const vector<Core> cores)
-{
-  int n = cores.size();
-
-  for (int i=0; i<n; i++)
-    if (cores[i].find(qb) != cores[i].end())
-      return i;
-
-  return -1;
+    os << ops << ", ";
+  os << endl;
 }
 
+// Teleportations are counted by Cores::moveQubit as the simulation goes
 int Statistics::getTeleportationsPerQubit(const int qb, const Cores& cores)
 {
-  int tps = 0;
-
-  for (list<vector<Core> >::const_iterator it_curr = cores.history.begin();
-       it_curr != cores.history.end(); ++it_curr)
-    {
-      list<vector<Core> >::const_iterator it_next = next(it_curr);
-      if (it_next != cores.history.end())
-	{
-	  int core_s = qbitToCore(qb, *it_curr);
-	  int core_d = qbitToCore(qb, *it_next);
-	  assert(core_s != -1 && core_d != -1);
-
-	  if (core_s != core_d)
-	    tps++;
-	}
-    }
-  
-  return tps;
+  return cores.getTeleportations(qb);
 }
 
-vector<int> Statistics::getTeleportationsPerQubit(const Circuit& circuit, const Cores& cores)
+vector<int> Statistics::getTeleportationsAllQubits(const int nqubits, const Cores& cores)
 {
-  vector<int> tpsqb(circuit.number_of_qubits);
+  vector<int> tpsqb(nqubits);
 
-  for (int qb = 0; qb < circuit.number_of_qubits; qb++)
+  for (int qb = 0; qb < nqubits; qb++)
     tpsqb[qb] = getTeleportationsPerQubit(qb, cores);
   
   return tpsqb;
 }
 
-void Statistics::displayTeleportationsPerQubit(const Circuit& circuit, const Cores& cores)
+void Statistics::displayTeleportationsPerQubit(const int nqubits, const Cores& cores, ostream& os)
 {
-  vector<int> tpsqb = getTeleportationsPerQubit(circuit, cores);
+  vector<int> tpsqb = getTeleportationsAllQubits(nqubits, cores);
 
   for (int tps : tpsqb)
-    cout << tps << ", ";
-  cout << endl;
+    os << tps << ", ";
+  os << endl;
   
 }
 
-void Statistics::display(const Circuit& circuit, const Cores& cores, const Architecture& arch,
-			 const bool detailed)
+double Statistics::getExecutionTime() const
+{
+  return computation_time + communication_time.getTotalTime() + fetch_time + decode_time + dispatch_time;
+}
+
+double Statistics::getCoherence() const
+{
+  return 100.0*exp(-getExecutionTime() / 268e-6);
+}
+
+// The operations per qubit are taken as a vector since a streamed
+// circuit is not available at the end of the simulation. The
+// parameters select the optional parts of the report.
+void Statistics::display(const vector<int>& operations_per_qubit, const Cores& cores, const Architecture& arch,
+			 const Parameters& params, ostream& os)
 {
-  cout << endl
+  bool detailed = params.stats_detailed;
+  
+  os << endl
        << "*** Statistics ***" << endl
        << "Executed gates: " << executed_gates << endl
        << "Intercore communications: " << intercore_comms << endl
-       << "Intercore traffic volume (bits): " << intercore_volume << endl
-       << "Throughput (Mbps): " << avg_throughput/1.0e6 << " avg, " << max_throughput/1.0e6 << " peak"
+       << "Intercore traffic volume (bits): " << intercore_volume << endl;
+  if (params.rebalance_period > 0)
+    os << "Migrated qubits: " << migrated_qubits << endl;
+  os << "Throughput (Mbps): " << avg_throughput/1.0e6 << " avg, " << max_throughput/1.0e6 << " peak"
        << endl;
 
   
   double avg, min, max;
   getCoresStats(cores.history, arch, avg, min, max);
-  cout << "Core utilization: " << avg << " avg, " << min << " min, " << max << " max" << endl;
+  os << "Core utilization: " << avg << " avg, " << min << " min, " << max << " max" << endl;
 
   if (detailed) {
-    cout << "Intercore communications (row is source, col is target):" << endl;
-    displayIntercoreCommunications(cores);
+    os << "Intercore communications (row is source, col is target):" << endl;
+    displayIntercoreCommunications(cores, os);
   }
 
   if (detailed) {
-    cout << "Operations per qubit: ";
-    displayOperationsPerQubit(circuit);
+    os << "Operations per qubit: ";
+    displayOperationsPerQubit(operations_per_qubit, os);
   }
 
   if (detailed) {
-    cout << "Teleportations per qubit: ";
-    displayTeleportationsPerQubit(circuit, cores);
+    os << "Teleportations per qubit: ";
+    displayTeleportationsPerQubit(operations_per_qubit.size(), cores, os);
   }
 
   
-  communication_time.display();
-  double execution_time = computation_time + communication_time.getTotalTime() + fetch_time + decode_time + dispatch_time;
-  cout << "Computation time (s): " << computation_time << endl
+  communication_time.display(params.epr_buffer_depth > 0, os);
+  double execution_time = getExecutionTime();
+  os << "Computation time (s): " << computation_time << endl
        << "Fetch time (s): " << fetch_time << endl
        << "Decode time (s): " << decode_time << endl
        << "Dispatch time (s): " << dispatch_time << endl
        << "Execution time (s): " << execution_time << endl
-       << "Coherence (%): " << 100.0*exp(-execution_time / 268e-6) << endl;
+       << "Coherence (%): " << getCoherence() << endl;
   
 }
 
+// Same content of display, as report fields
+void Statistics::addToReport(Report& report, const vector<int>& operations_per_qubit, const Cores& cores,
+			     const Architecture& arch, const bool detailed)
+{
+  addFieldsToReport(report);
+  
+  double avg, min, max;
+  getCoresStats(cores.history, arch, avg, min, max);
+  report.add("core_utilization_avg", avg);
+  report.add("core_utilization_min", min);
+  report.add("core_utilization_max", max);
+
+  if (detailed)
+    {
+      report.add("intercore_communications", getIntercoreCommunications(cores));
+      report.add("operations_per_qubit", operations_per_qubit);
+      report.add("teleportations_per_qubit", getTeleportationsAllQubits(operations_per_qubit.size(), cores));
+    }
+}
+
+void Statistics::addFieldsToReport(Report& report) const
+{
+  report.add("executed_gates", executed_gates);
+  report.add("intercore_comms", intercore_comms);
+  report.add("intercore_volume", intercore_volume);
+  report.add("migrated_qubits", migrated_qubits);
+  report.add("avg_throughput", avg_throughput);
+  report.add("max_throughput", max_throughput);
+  report.add("throughput_samples", samples);
+  communication_time.addFieldsToReport(report);
+  report.add("computation_time", computation_time);
+  report.add("fetch_time", fetch_time);
+  report.add("decode_time", decode_time);
+  report.add("dispatch_time", dispatch_time);
+  report.add("execution_time", getExecutionTime());
+  report.add("coherence", getCoherence());
+}
+
 void Statistics::updateStatistics(const Statistics& stats, const double th)
 {
   executed_gates += stats.executed_gates;
   intercore_comms += stats.intercore_comms;
   intercore_volume += stats.intercore_volume;
+  migrated_qubits += stats.migrated_qubits;
   computation_time += stats.computation_time;
   
   communication_time.t_epr += stats.communication_time.t_epr;
@@ -220,6 +212,7 @@ void Statistics::updateStatistics(const Statistics& stats, const double th)
   communication_time.t_pre += stats.communication_time.t_pre;
   communication_time.t_clas += stats.communication_time.t_clas;
   communication_time.t_post += stats.communication_time.t_post;
+  communication_time.t_overlap += stats.communication_time.t_overlap;
 
   fetch_time += stats.fetch_time;
   decode_time += stats.decode_time;
@@ -239,40 +232,12 @@ void Statistics::updateStatistics(const Statistics& stats, const double th)
 }
 
 
-void Statistics::getCoresStats(const vector<Core>& cores, const Architecture& arch,
+void Statistics::getCoresStats(const CoresHistory& history, const Architecture& arch,
 			       double& avg_u, double& min_u, double& max_u)
 {
-  min_u = numeric_limits<double>::max();
-  max_u = numeric_limits<double>::min();
-  double sum_u = 0.0;
+  assert(history.qubits_per_core == arch.qubits_per_core);
   
-  for (const auto& core : cores)
-    {
-      double utilization = (double)core.size() / arch.qubits_per_core;
-      sum_u += utilization;
-      if (utilization < min_u) min_u = utilization;
-      if (utilization > max_u) max_u = utilization;      
-    }
-
-  avg_u = sum_u / cores.size();
-}
-
-void Statistics::getCoresStats(const list<vector<Core> >& history, const Architecture& arch,
-			       double& avg_u, double& min_u, double& max_u)
-{
-  double _avg_u, _min_u, _max_u;
-  double sum_avg_u = 0.0;
-  min_u = numeric_limits<double>::max();
-  max_u = numeric_limits<double>::min();
-  
-  for (const auto& coresh : history)
-    {
-      getCoresStats(coresh, arch, _avg_u, _min_u, _max_u);
-
-      sum_avg_u += _avg_u;
-      if (_min_u < min_u) min_u = _min_u;
-      if (_max_u > max_u) max_u = _max_u;
-    }
-
-  avg_u = sum_avg_u / history.size();
+  avg_u = history.sum_avg_u / history.steps;
+  min_u = history.min_u;
+  max_u = history.max_u;
 }
@@ -1,16 +1,20 @@
 #ifndef __STATISTICS_H__
 #define __STATISTICS_H__
 
+#include <iostream>
 #include "core.h"
 #include "circuit.h"
 #include "architecture.h"
+#include "parameters.h"
 #include "communication_time.h"
+#include "report.h"
 
 struct Statistics
 {
-  int executed_gates;
-  int intercore_comms;
-  int intercore_volume;
+  long long executed_gates;
+  long long intercore_comms;
+  long long intercore_volume;
+  int migrated_qubits; // qubits moved by the rebalancing of the cores
   CommunicationTime communication_time;
   double computation_time;
   double avg_throughput, max_throughput;
@@ -23,26 +27,28 @@ struct Statistics
   Statistics();
   
   void updateStatistics(const Statistics& stats, const double th);
+  double getExecutionTime() const;
+  double getCoherence() const;
   
-  void display(const Circuit& circuit, const Cores& cores, const Architecture& arch,
-	       const bool detailed = true);
+  void display(const vector<int>& operations_per_qubit, const Cores& cores, const Architecture& arch,
+	       const Parameters& params, ostream& os = cout);
+  void addToReport(Report& report, const vector<int>& operations_per_qubit, const Cores& cores,
+		   const Architecture& arch, const bool detailed = true);
+  void addFieldsToReport(Report& report) const;
 
-  void getCoresStats(const vector<Core>& cores, const Architecture& arch,
-		     double& avg_u, double& min_u, double& max_u);
-  void getCoresStats(const list<vector<Core> >& history, const Architecture& arch,
+  void getCoresStats(const CoresHistory& history, const Architecture& arch,
 		     double& avg_u, double& min_u, double& max_u);
 
-  void displayIntercoreCommunications(const Cores& cores);
+  void displayIntercoreCommunications(const Cores& cores, ostream& os = cout);
   int countCommunications(const Cores& cores, const int src, const int dst);
   vector<vector<int> > getIntercoreCommunications(const Cores& cores);
 
-  void displayOperationsPerQubit(const Circuit& circuit);
+  void displayOperationsPerQubit(const vector<int>& opsqb, ostream& os = cout);
   vector<int> getOperationsPerQubit(const Circuit& circuit);
 
-  void displayTeleportationsPerQubit(const Circuit& circuit, const Cores& cores);
-  vector<int> getTeleportationsPerQubit(const Circuit& circuit, const Cores& cores);
+  void displayTeleportationsPerQubit(const int nqubits, const Cores& cores, ostream& os = cout);
+  vector<int> getTeleportationsAllQubits(const int nqubits, const Cores& cores);
   int getTeleportationsPerQubit(const int qb, const Cores& cores);
-  int qbitToCore(const int qb, const vector<Core> cores);
 
 
 };
@@ -0,0 +1,313 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include "sweep.h"
+#include "noc.h"
+#include "mapping.h"
+#include "core.h"
+#include "simulation.h"
+#include "command_line.h"
+#include "utils.h"
+#include "profiler.h"
+
+using namespace std;
+
+bool Sweep::readFromFile(const string& file_name)
+{
+  ifstream input_file(file_name);
+  if (!input_file.is_open())
+    return false;
+
+  vector<map<string,string> > listed_points;
+  vector<pair<string,vector<string> > > grid;
+  
+  string line;
+  int line_no = 0;
+  while (getline(input_file, line))
+    {
+      line_no++;
+      istringstream iss(line);
+      string kind;
+      if (!(iss >> kind) || kind[0] == '#')
+	continue;
+
+      if (kind == "grid")
+	{
+	  string param, value;
+	  vector<string> values;
+	  iss >> param;
+	  while (iss >> value)
+	    values.push_back(value);
+	  if (values.empty())
+	    {
+	      cerr << file_name << ":" << line_no << ": grid without values" << endl;
+	      return false;
+	    }
+	  grid.push_back(make_pair(param, values));
+	}
+      else if (kind == "point")
+	{
+	  map<string,string> point;
+	  string param, value;
+	  while (iss >> param)
+	    {
+	      if (!(iss >> value))
+		{
+		  cerr << file_name << ":" << line_no << ": missing value of '" << param << "'" << endl;
+		  return false;
+		}
+	      point[param] = value;
+	    }
+	  listed_points.push_back(point);
+	}
+      else
+	{
+	  cerr << file_name << ":" << line_no << ": expected 'grid' or 'point'" << endl;
+	  return false;
+	}
+    }
+
+  if (listed_points.empty())
+    listed_points.push_back(map<string,string>());
+
+  // expand every grid dimension over the points built so far
+  points = listed_points;
+  for (const auto& dim : grid)
+    {
+      vector<map<string,string> > expanded;
+      for (const auto& point : points)
+	for (const auto& value : dim.second)
+	  {
+	    map<string,string> p = point;
+	    p[dim.first] = value;
+	    expanded.push_back(p);
+	  }
+      points = expanded;
+    }
+  
+  return true;
+}
+
+// ----------------------------------------------------------------------
+// Each point owns its NoC, mapping and cores, the circuit and its
+// interaction graph are only read
+void Sweep::runPoint(const Circuit& circuit, const InteractionGraph& graph,
+		     const Architecture& architecture, const Parameters& parameters,
+		     mt19937& gen, SweepResult& result)
+{
+  PROFILE_SCOPE("sweep run");
+  
+  NoC noc(architecture.mesh_x, architecture.mesh_y, architecture.link_width, parameters.noc_clock_time,
+	  ceil(log2(architecture.qubits_per_core * architecture.number_of_cores)));
+  if (architecture.wireless_enabled)
+    noc.enableWiNoC(parameters.wbit_rate, architecture.radio_channels, parameters.token_pass_time);
+
+  Mapping mapping = (architecture.mapping_type == MAP_PARTITION) ?
+    Mapping(graph, architecture.number_of_cores, architecture.qubits_per_core, gen) :
+    Mapping(circuit.number_of_qubits, architecture.number_of_cores, architecture.mapping_type, gen);
+
+  Cores cores(architecture, mapping);
+  cores.setHistoryCheckpointPeriod(parameters.history_checkpoint_period);
+  cores.setHistoryCheckpoints(parameters.history_checkpoints);
+
+  Simulation simulation;
+  result.stats = simulation.simulate(circuit, architecture, noc, parameters, mapping, cores);
+  result.stats.getCoresStats(cores.history, architecture, result.core_utilization_avg,
+			     result.core_utilization_min, result.core_utilization_max);
+}
+
+// ----------------------------------------------------------------------
+// The points are configured upfront, so that unrecognized parameters
+// and unsupported combinations are reported once, then simulated by nthreads workers picking the
+// next run from a shared counter. The random generator of each run
+// is seeded from the seed of the point and the repetition index, thus
+// results do not depend on the number of threads
+bool Sweep::run(const Circuit& circuit, const Architecture& architecture,
+		const Parameters& parameters, const int nthreads)
+{
+  vector<Architecture> archs(points.size(), architecture);
+  vector<Parameters> params(points.size(), parameters);
+  for (size_t i=0; i<points.size(); i++)
+    {
+      overrideParameters(points[i], archs[i], params[i]);
+      if (!checkParameters(archs[i], params[i]))
+	{
+	  cerr << "in sweep point " << i << endl;
+	  return false;
+	}
+    }
+
+  // the interaction graph is shared by the points mapped by partition
+  InteractionGraph graph;
+  for (const auto& arch : archs)
+    if (arch.mapping_type == MAP_PARTITION)
+      {
+	InteractionGraphBuilder builder;
+	builder.addGates(circuit.getGates());
+	graph = builder.build(circuit.number_of_qubits);
+	break;
+      }
+
+  size_t nruns = points.size() * repetitions;
+  results.assign(nruns, SweepResult());
+  
+  atomic<size_t> next_run(0);
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next_run++) < nruns)
+      {
+	size_t p = i / repetitions;
+	seed_seq seq{params[p].seed, (unsigned)(i % repetitions)};
+	mt19937 gen(seq);
+	results[i].seed = params[p].seed;
+	runPoint(circuit, graph, archs[p], params[p], gen, results[i]);
+      }
+  };
+
+  int nworkers = min((size_t)max(nthreads, 1), nruns);
+  vector<thread> workers;
+  for (int w=0; w<nworkers; w++)
+    workers.push_back(thread(worker));
+  for (auto& w : workers)
+    w.join();
+
+  return true;
+}
+
+// ----------------------------------------------------------------------
+void Sweep::displayPoint(const size_t p, ostream& os)
+{
+  os << p << "\t";
+  if (points[p].empty())
+    os << "-";
+  for (auto it = points[p].begin(); it != points[p].end(); ++it)
+    os << (it == points[p].begin() ? "" : ",") << it->first << "=" << it->second;
+}
+
+// ----------------------------------------------------------------------
+void Sweep::display(ostream& os)
+{
+  if (repetitions > 1)
+    {
+      displayRepetitions(os);
+      return;
+    }
+  
+  os << endl
+     << "*** Sweep ***" << endl
+     << "point\toverrides\texecuted_gates\tintercore_comms\tintercore_volume\t"
+     << "avg_throughput_mbps\tcommunication_time\texecution_time\t"
+     << "core_utilization_avg\tcore_utilization_min\tcore_utilization_max" << endl;
+  
+  for (size_t i=0; i<points.size(); i++)
+    {
+      const SweepResult& r = results[i];
+
+      displayPoint(i, os);
+      os << "\t" << r.stats.executed_gates
+	 << "\t" << r.stats.intercore_comms
+	 << "\t" << r.stats.intercore_volume
+	 << "\t" << r.stats.avg_throughput/1.0e6
+	 << "\t" << r.stats.communication_time.getTotalTime()
+	 << "\t" << r.stats.getExecutionTime()
+	 << "\t" << r.core_utilization_avg
+	 << "\t" << r.core_utilization_min
+	 << "\t" << r.core_utilization_max << endl;
+    }
+}
+
+// ----------------------------------------------------------------------
+// Summary of the repetitions of point p for each metric
+vector<pair<string,SampleSummary> > Sweep::summarizePoint(const size_t p)
+{
+  vector<double> execution_time, throughput, volume;
+  for (int r=0; r<repetitions; r++)
+    {
+      const Statistics& stats = results[p*repetitions + r].stats;
+      execution_time.push_back(stats.getExecutionTime());
+      throughput.push_back(stats.avg_throughput/1.0e6);
+      volume.push_back(stats.intercore_volume);
+    }
+
+  return {
+    {"execution_time", summarizeSamples(execution_time)},
+    {"avg_throughput_mbps", summarizeSamples(throughput)},
+    {"intercore_volume", summarizeSamples(volume)} };
+}
+
+// ----------------------------------------------------------------------
+// One row per point and metric, summarizing its repetitions. The
+// non-finite samples (e.g. the throughput of a run without
+// communications) are left out of the figures and counted apart.
+void Sweep::displayRepetitions(ostream& os)
+{
+  os << endl
+     << "*** Repetitions (" << repetitions << " per point) ***" << endl
+     << "point\toverrides\tmetric\tmean\tstddev\tmin\tp5\tp50\tp95\tmax\tnonfinite" << endl;
+
+  for (size_t p=0; p<points.size(); p++)
+    for (const auto& m : summarizePoint(p))
+      {
+	const SampleSummary& s = m.second;
+	displayPoint(p, os);
+	os << "\t" << m.first;
+	for (double x : {s.mean, s.stddev, s.min, s.p5, s.p50, s.p95, s.max})
+	  {
+	    if (isfinite(x))
+	      os << "\t" << x;
+	    else
+	      os << "\t-";
+	  }
+	os << "\t" << s.nonfinite << endl;
+      }
+}
+
+// ----------------------------------------------------------------------
+// One report per run. With repetitions, every report also carries the
+// summary of its point (the same in all the runs of the point), so
+// that JSON and CSV have the same fields in every record.
+void Sweep::writeReports(ReportWriter& writer)
+{
+  vector<pair<string,SampleSummary> > summary;
+  
+  for (size_t i=0; i<results.size(); i++)
+    {
+      size_t p = i / repetitions;
+      string overrides;
+      for (auto it = points[p].begin(); it != points[p].end(); ++it)
+	overrides += (it == points[p].begin() ? "" : ",") + it->first + "=" + it->second;
+      
+      Report report;
+      report.add("point", (int)p);
+      report.add("repetition", (int)(i % repetitions));
+      report.add("seed", (long long)results[i].seed);
+      report.add("overrides", overrides);
+      results[i].stats.addFieldsToReport(report);
+      report.add("core_utilization_avg", results[i].core_utilization_avg);
+      report.add("core_utilization_min", results[i].core_utilization_min);
+      report.add("core_utilization_max", results[i].core_utilization_max);
+
+      if (repetitions > 1)
+	{
+	  if (i % repetitions == 0)
+	    summary = summarizePoint(p);
+	  for (const auto& m : summary)
+	    {
+	      const SampleSummary& s = m.second;
+	      report.add(m.first + "_mean", s.mean);
+	      report.add(m.first + "_stddev", s.stddev);
+	      report.add(m.first + "_min", s.min);
+	      report.add(m.first + "_p5", s.p5);
+	      report.add(m.first + "_p50", s.p50);
+	      report.add(m.first + "_p95", s.p95);
+	      report.add(m.first + "_max", s.max);
+	      report.add(m.first + "_nonfinite", s.nonfinite);
+	    }
+	}
+
+      writer.write(report);
+    }
+}
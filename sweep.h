@@ -0,0 +1,59 @@
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <vector>
+#include <map>
+#include <string>
+#include <random>
+#include <iostream>
+#include "architecture.h"
+#include "parameters.h"
+#include "circuit.h"
+#include "statistics.h"
+#include "report.h"
+#include "partition.h"
+#include "utils.h"
+
+using namespace std;
+
+// Result of the simulation of a point of the sweep
+struct SweepResult
+{
+  unsigned seed; // the run draws from the stream seeded by (seed, repetition)
+  Statistics stats;
+  double core_utilization_avg, core_utilization_min, core_utilization_max;
+};
+
+// A parameter sweep is a list of override sets (points), each one
+// simulated independently on the same circuit. The sweep file
+// contains lines of the form
+//   grid <param> <value> <value> ...
+//   point <param> <value> [<param> <value> ...]
+// The points are the product of the listed points (or a single empty
+// point if none) by all the combinations of the grid values. Each
+// point can be repeated with independent random streams, repetition r
+// drawing from the stream seeded by (seed, r).
+struct Sweep
+{
+  vector<map<string,string> > points;
+  int repetitions;
+  vector<SweepResult> results; // results[point*repetitions + repetition]
+
+  Sweep() : repetitions(1) {}
+
+  bool readFromFile(const string& file_name);
+
+  bool run(const Circuit& circuit, const Architecture& architecture,
+	   const Parameters& parameters, const int nthreads);
+  void runPoint(const Circuit& circuit, const InteractionGraph& graph,
+		const Architecture& architecture, const Parameters& parameters,
+		mt19937& gen, SweepResult& result);
+
+  void display(ostream& os = cout);
+  void displayPoint(const size_t p, ostream& os);
+  void displayRepetitions(ostream& os);
+  vector<pair<string,SampleSummary> > summarizePoint(const size_t p);
+  void writeReports(ReportWriter& writer);
+};
+
+#endif
@@ -0,0 +1,357 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <numeric>
+#include <cstdio>
+#include <unistd.h>
+#include "architecture.h"
+#include "mapping.h"
+#include "core.h"
+#include "partition.h"
+#include "circuit.h"
+#include "noc.h"
+#include "simulation.h"
+
+using namespace std;
+
+// Unit tests of the parts of the simulator whose results are not
+// visible in its output. Every test generates its input from a fixed
+// seed and returns the number of failed checks.
+
+#define TEST_SEED 12345
+
+static int failures = 0;
+
+#define CHECK(cond)							\
+  do {									\
+    if (!(cond))							\
+      {									\
+	cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << endl; \
+	failures++;							\
+      }									\
+  } while (0)
+
+static vector<Core> sortedOccupancy(const vector<Core>& cores)
+{
+  vector<Core> sorted = cores;
+  for (auto& core : sorted)
+    sort(core.qubits.begin(), core.qubits.end());
+
+  return sorted;
+}
+
+static bool sameOccupancy(const vector<Core>& a, const vector<Core>& b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (size_t c=0; c<a.size(); c++)
+    if (a[c].qubits != b[c].qubits)
+      return false;
+
+  return true;
+}
+
+// ----------------------------------------------------------------------
+// The occupancy rebuilt from the history at a past step must match the
+// snapshot taken at that step. The whole history is kept unless
+// max_checkpoints > 0, in which case the log must stay bounded
+static void checkCoresHistory(const int period, const int max_checkpoints)
+{
+  const int ncores = 4, qubits_per_core = 8, nqubits = 20, nsteps = 60;
+  mt19937 gen(TEST_SEED);
+
+  Architecture arch;
+  arch.mesh_x = 2;
+  arch.mesh_y = 2;
+  arch.qubits_per_core = qubits_per_core;
+  arch.updateDerivedVariables();
+
+  Mapping mapping(nqubits, ncores, MAP_SEQUENTIAL, gen);
+  Cores cores(arch, mapping);
+  cores.setHistoryCheckpointPeriod(period);
+  cores.setHistoryCheckpoints(max_checkpoints);
+
+  vector<vector<Core> > snapshots;
+  vector<pair<int,int> > ancillas; // (ancilla, core)
+  size_t max_events = 0;
+
+  for (int step=0; step<nsteps; step++)
+    {
+      for (int i=0; i<3; i++)
+	{
+	  int qb = uniform_int_distribution<int>(0, nqubits - 1)(gen);
+	  int src = mapping.qubit2CoreSafe(qb);
+	  int dst = uniform_int_distribution<int>(0, ncores - 1)(gen);
+	  if (dst != src && (int)cores.cores[dst].size() < qubits_per_core)
+	    {
+	      cores.moveQubit(qb, src, dst);
+	      mapping.mapQubit(qb, dst);
+	    }
+	}
+
+      int core_id = uniform_int_distribution<int>(0, ncores - 1)(gen);
+      int ancilla;
+      if (cores.allocateAncilla(core_id, arch, mapping, ancilla))
+	ancillas.push_back(make_pair(ancilla, core_id));
+      if (ancillas.size() > 2)
+	{
+	  cores.freeAncilla(ancillas.front().second, ancillas.front().first, mapping);
+	  ancillas.erase(ancillas.begin());
+	}
+
+      snapshots.push_back(sortedOccupancy(cores.cores));
+      cores.saveHistory();
+      max_events = max(max_events, cores.history.events.size());
+    }
+
+  const CoresHistory& history = cores.history;
+  CHECK(history.steps == nsteps);
+  if (max_checkpoints > 0)
+    {
+      CHECK(history.checkpoints.size() == (size_t)max_checkpoints);
+      CHECK(history.getFirstStep() > 0);
+      CHECK(max_events <= (size_t)(max_checkpoints + 1) * period * 5);
+    }
+  else
+    CHECK(history.getFirstStep() == 0);
+  for (int step=history.getFirstStep(); step<nsteps; step++)
+    if (!sameOccupancy(history.getOccupancy(step), snapshots[step]))
+      {
+	cerr << "period " << period << ", " << max_checkpoints << " checkpoints: occupancy of step "
+	     << step << " differs from its snapshot" << endl;
+	failures++;
+      }
+}
+
+void testCoresHistory()
+{
+  checkCoresHistory(0, 0); // the defaults: only the initial checkpoint
+  checkCoresHistory(3, 0);
+  checkCoresHistory(3, 4);
+}
+
+// ----------------------------------------------------------------------
+// Ancillas moved between cores are erased from the slot table and set
+// again, whatever their age in the pool of ancilla ids
+void testAncillaMoves()
+{
+  const int ncores = 4, qubits_per_core = 8, nqubits = 8, nsteps = 200;
+  mt19937 gen(TEST_SEED);
+
+  Architecture arch;
+  arch.mesh_x = 2;
+  arch.mesh_y = 2;
+  arch.qubits_per_core = qubits_per_core;
+  arch.updateDerivedVariables();
+
+  Mapping mapping(nqubits, ncores, MAP_SEQUENTIAL, gen);
+  Cores cores(arch, mapping);
+  vector<int> ancillas;
+
+  for (int step=0; step<nsteps; step++)
+    {
+      int core_id = uniform_int_distribution<int>(0, ncores - 1)(gen);
+      int ancilla;
+      if (ancillas.size() < 4 && cores.allocateAncilla(core_id, arch, mapping, ancilla))
+	ancillas.push_back(ancilla);
+      if (ancillas.empty())
+	continue;
+
+      // the oldest ancilla is the one at the front of the pool
+      int i = (step % 3 == 0) ? 0 : uniform_int_distribution<int>(0, ancillas.size() - 1)(gen);
+      int qb = ancillas[i];
+      int src = mapping.qubit2CoreSafe(qb);
+      int dst = uniform_int_distribution<int>(0, ncores - 1)(gen);
+      if (dst != src && (int)cores.cores[dst].size() < qubits_per_core)
+	{
+	  cores.moveQubit(qb, src, dst);
+	  mapping.mapQubit(qb, dst);
+	  CHECK(cores.contains(dst, qb) && !cores.contains(src, qb));
+	}
+
+      if (step % 5 == 4)
+	{
+	  cores.freeAncilla(mapping.qubit2CoreSafe(ancillas.front()), ancillas.front(), mapping);
+	  ancillas.erase(ancillas.begin());
+	}
+
+      for (int c=0; c<ncores; c++)
+	for (int a : cores.cores[c])
+	  CHECK(cores.contains(c, a));
+    }
+}
+
+// ----------------------------------------------------------------------
+// Qubits forming nparts clusters of dense interactions, with a few
+// interactions across clusters and shuffled ids: the partition must
+// respect the maximum part weight and cut no more than the interactions
+// across clusters, far fewer than an even split in id order
+void testPartition()
+{
+  const int nparts = 4, cluster_size = 16, nqubits = nparts * cluster_size;
+  const int internal_gates = 60, external_gates = 6;
+  mt19937 gen(TEST_SEED);
+
+  vector<int> label(nqubits);
+  iota(label.begin(), label.end(), 0);
+  shuffle(label.begin(), label.end(), gen);
+
+  InteractionGraphBuilder builder;
+  auto addGate = [&](const int a, const int b) {
+    int q[2] = { label[a], label[b] };
+    builder.addGate(Gate(q, q + 2));
+  };
+  uniform_int_distribution<int> member(0, cluster_size - 1);
+  for (int c=0; c<nparts; c++)
+    {
+      // a ring keeps every cluster connected
+      for (int i=0; i<cluster_size; i++)
+	addGate(c * cluster_size + i, c * cluster_size + (i + 1) % cluster_size);
+      for (int i=0; i<internal_gates; i++)
+	{
+	  int a = member(gen), b = member(gen);
+	  if (a != b)
+	    addGate(c * cluster_size + a, c * cluster_size + b);
+	}
+    }
+  for (int i=0; i<external_gates; i++)
+    {
+      int c = i % nparts;
+      addGate(c * cluster_size + member(gen), ((c + 1) % nparts) * cluster_size + member(gen));
+    }
+  InteractionGraph graph = builder.build(nqubits);
+
+  for (int max_part_weight : { cluster_size, cluster_size + 2 })
+    {
+      vector<int> part = partitionGraph(graph, nparts, max_part_weight, gen);
+      CHECK((int)part.size() == nqubits);
+      vector<long long> pweight = getPartWeights(graph, part, nparts);
+      for (int p=0; p<nparts; p++)
+	CHECK(pweight[p] <= max_part_weight);
+
+      vector<int> even(nqubits);
+      for (int v=0; v<nqubits; v++)
+	even[v] = v / cluster_size;
+      CHECK(getEdgeCut(graph, part) <= external_gates);
+      CHECK(getEdgeCut(graph, part) < getEdgeCut(graph, even));
+    }
+}
+
+// ----------------------------------------------------------------------
+static bool sameCircuit(const Circuit& a, const Circuit& b)
+{
+  return a.number_of_qubits == b.number_of_qubits &&
+    a.number_of_gates == b.number_of_gates &&
+    a.number_of_stages == b.number_of_stages &&
+    equal(a.getGateOffsets(), a.getGateOffsets() + a.number_of_gates + 1, b.getGateOffsets()) &&
+    equal(a.getSliceOffsets(), a.getSliceOffsets() + a.number_of_stages + 1, b.getSliceOffsets()) &&
+    equal(a.getQubits(), a.getQubits() + a.getGateOffsets()[a.number_of_gates], b.getQubits());
+}
+
+// A random circuit written as text, read back, converted to binary,
+// read back (mapped) and converted to text again must stay the same
+void testCircuitRoundTrip()
+{
+  mt19937 gen(TEST_SEED);
+  Circuit circuit;
+  circuit.generateCircuit(32, 500, {0.3, 0.6, 0.1}, gen);
+
+  char text_fn[] = "/tmp/qctest_text_XXXXXX";
+  char binary_fn[] = "/tmp/qctest_binary_XXXXXX";
+  int text_fd = mkstemp(text_fn), binary_fd = mkstemp(binary_fn);
+  CHECK(text_fd >= 0 && binary_fd >= 0);
+  if (text_fd < 0 || binary_fd < 0)
+    return;
+  close(text_fd);
+  close(binary_fd);
+
+  Circuit from_text, from_binary, from_text_again;
+  CHECK(circuit.writeTextFile(text_fn));
+  CHECK(from_text.readFromFile(text_fn));
+  CHECK(sameCircuit(circuit, from_text));
+
+  CHECK(from_text.writeBinaryFile(binary_fn));
+  CHECK(from_binary.readFromFile(binary_fn));
+  CHECK(from_binary.binary_file != NULL);
+  CHECK(sameCircuit(circuit, from_binary));
+
+  CHECK(from_binary.writeTextFile(text_fn));
+  CHECK(from_text_again.readFromFile(text_fn));
+  CHECK(sameCircuit(circuit, from_text_again));
+
+  remove(text_fn);
+  remove(binary_fn);
+}
+
+// ----------------------------------------------------------------------
+// A slice of six cores with one LTM port each, the gates listed so that
+// the greedy policy takes (2,5) and (1,3) first and blocks the other
+// three: it needs three rounds, where the matching policy takes the
+// maximum b-matching (2,5), (3,0), (1,4) then (4,5), (1,3)
+static int countRemoteRounds(const int ltm_scheduling)
+{
+  const int edges[][2] = { {2, 5}, {4, 5}, {1, 3}, {3, 0}, {1, 4} };
+  const int ngates = 5, nqubits = 2 * ngates;
+  mt19937 gen(TEST_SEED);
+
+  Architecture arch;
+  arch.mesh_x = 3;
+  arch.mesh_y = 2;
+  arch.link_width = 8;
+  arch.qubits_per_core = 8;
+  arch.ltm_ports = 1;
+  arch.teleportation_type = TP_TYPE_A2A;
+  arch.dst_selection_mode = DST_SEL_LOAD_INDEPENDENT;
+  arch.ltm_scheduling = ltm_scheduling;
+  arch.updateDerivedVariables();
+
+  Parameters params;
+  params.gate_delay = 1.0;
+  NoC noc(arch.mesh_x, arch.mesh_y, arch.link_width, 1e-9, arch.qubits_per_core);
+
+  // the qubits of gate g are 2g on its first core and 2g+1 on the
+  // second one, the destination of a load independent selection
+  Mapping mapping(nqubits, arch.number_of_cores, MAP_SEQUENTIAL, gen);
+  ParallelGates rgates;
+  for (int g=0; g<ngates; g++)
+    {
+      mapping.mapQubit(2 * g, edges[g][0]);
+      mapping.mapQubit(2 * g + 1, edges[g][1]);
+      rgates.push_back({2 * g, 2 * g + 1});
+    }
+  Cores cores(arch, mapping);
+
+  Simulation simulation;
+  Statistics stats = simulation.remoteExecution(arch, noc, params, rgates, mapping, cores);
+  CHECK(stats.executed_gates == ngates);
+  for (int g=0; g<ngates; g++)
+    CHECK(mapping.qubit2CoreSafe(2 * g) == edges[g][1]);
+
+  // a round executes its gates in a gate delay
+  return (int)stats.computation_time;
+}
+
+void testRemoteRounds()
+{
+  CHECK(countRemoteRounds(LTM_SCHED_GREEDY) == 3);
+  CHECK(countRemoteRounds(LTM_SCHED_MATCHING) == 2);
+}
+
+int main()
+{
+  testCoresHistory();
+  testAncillaMoves();
+  testPartition();
+  testCircuitRoundTrip();
+  testRemoteRounds();
+
+  if (failures > 0)
+    {
+      cout << failures << " checks failed" << endl;
+      return 1;
+    }
+
+  cout << "all tests passed" << endl;
+  return 0;
+}
@@ -1,15 +1,15 @@
 #include <algorithm>
 #include <random>
+#include <cmath>
+#include <cassert>
+#include <limits>
 #include "utils.h"
 
 //----------------------------------------------------------------------
 // returns a random integer between 0 and prob.size()-1 with prob(i) =
 // prob[i]
-int getRandomNumber(const vector<float> prob)
+int getRandomNumber(const vector<float>& prob, mt19937& gen)
 {
-  random_device rd;
-  mt19937 gen(rd());
-
   std::discrete_distribution<int> dist(prob.begin(), prob.end());
 
   return dist(gen);
@@ -18,16 +18,13 @@ int getRandomNumber(const vector<float> prob)
 //----------------------------------------------------------------------
 // returns a set of size set_size of random integer without repetition
 // between 0 and n-1
-set<int> getRandomNoRepetition(const int n, const int set_size)
+set<int> getRandomNoRepetition(const int n, const int set_size, mt19937& gen)
 {
   vector<int> numbers;
 
   for (int i = 0; i < n; ++i)
     numbers.push_back(i);
 
-  random_device rd;
-  mt19937 gen(rd());
-
   shuffle(numbers.begin(), numbers.end(), gen);
 
   set<int> result;
@@ -36,3 +33,50 @@ set<int> getRandomNoRepetition(const int n, const int set_size)
 
   return result;
 }
+
+//----------------------------------------------------------------------
+// percentiles are linearly interpolated between the closest ranks
+static double percentile(const vector<double>& sorted, const double p)
+{
+  double rank = p * (sorted.size() - 1);
+  size_t lo = floor(rank);
+  size_t hi = ceil(rank);
+
+  return sorted[lo] + (rank - lo) * (sorted[hi] - sorted[lo]);
+}
+
+SampleSummary summarizeSamples(vector<double> samples)
+{
+  SampleSummary s;
+  
+  assert(!samples.empty());
+  size_t nsamples = samples.size();
+  samples.erase(remove_if(samples.begin(), samples.end(), [](const double x) { return !isfinite(x); }),
+		samples.end());
+  s.nonfinite = nsamples - samples.size();
+  if (samples.empty())
+    {
+      s.mean = s.stddev = s.min = s.p5 = s.p50 = s.p95 = s.max = numeric_limits<double>::quiet_NaN();
+      return s;
+    }
+  
+  sort(samples.begin(), samples.end());
+
+  double sum = 0.0;
+  for (double x : samples)
+    sum += x;
+  s.mean = sum / samples.size();
+
+  double sq = 0.0;
+  for (double x : samples)
+    sq += (x - s.mean) * (x - s.mean);
+  s.stddev = samples.size() > 1 ? sqrt(sq / (samples.size() - 1)) : 0.0;
+
+  s.min = samples.front();
+  s.p5 = percentile(samples, 0.05);
+  s.p50 = percentile(samples, 0.50);
+  s.p95 = percentile(samples, 0.95);
+  s.max = samples.back();
+
+  return s;
+}
@@ -3,16 +3,29 @@
 
 #include <vector>
 #include <set>
+#include <random>
 
 using namespace std;
 
 // returns a random integer between 0 and prob.size()-1 with prob(i) =
 // prob[i]
-int getRandomNumber(const vector<float> prob);
+int getRandomNumber(const vector<float>& prob, mt19937& gen);
 
 // returns a set of size set_size of random integer without repetition
 // between 0 and n-1
-set<int> getRandomNoRepetition(const int n, const int set_size);
+set<int> getRandomNoRepetition(const int n, const int set_size, mt19937& gen);
+
+// mean, standard deviation and percentiles of the finite samples of
+// a set, the others are only counted (all the figures are NaN if no
+// sample is finite)
+struct SampleSummary
+{
+  double mean, stddev;
+  double min, p5, p50, p95, max;
+  int nonfinite;
+};
+
+SampleSummary summarizeSamples(vector<double> samples);
 
 
 #endif